@@ -0,0 +1,195 @@
+// BarnesHut.cpp – Quadtree force engine for large body counts
+
+#include <algorithm>
+#include <cmath>
+#include "BarnesHut.h"
+#include "ForceKernelImpl.h"
+
+template <class T>
+BarnesHut<T>::BarnesHut()
+    : nodeCount(0), srcX(nullptr), srcY(nullptr), srcM(nullptr), theta(0.5)
+{
+}
+
+// Preallocates the node arena, the tree never allocates afterwards.
+// When a step needs more nodes than reserved, the remaining cells simply stay leaves.
+template <class T>
+void BarnesHut<T>::reserve(int maxBodies)
+{
+    nodes.assign(static_cast<size_t>(maxBodies) * 4 + 64, Node{});
+    order.assign(maxBodies, 0);
+    px.assign(maxBodies, T(0));
+    py.assign(maxBodies, T(0));
+    pm.assign(maxBodies, T(0));
+    nodeCount = 0;
+}
+
+// Opening angle, 0 is exact
+template <class T>
+void BarnesHut<T>::setTheta(double theta)
+{
+    this->theta = theta;
+}
+
+// Rebuilds the tree for the current positions, resets the arena
+template <class T>
+void BarnesHut<T>::build(const ForceField<T> &field)
+{
+    nodeCount = 0;
+
+    if (field.count <= 0)
+        return;
+
+    srcX = field.x;
+    srcY = field.y;
+    srcM = field.mass;
+
+    T minX = srcX[0], maxX = srcX[0];
+    T minY = srcY[0], maxY = srcY[0];
+
+    for (int i = 0; i < field.count; ++i)
+    {
+        order[i] = i;
+        minX = std::min(minX, srcX[i]);
+        maxX = std::max(maxX, srcX[i]);
+        minY = std::min(minY, srcY[i]);
+        maxY = std::max(maxY, srcY[i]);
+    }
+
+    // Square root cell around all bodies
+    Node &root = nodes[0];
+    root.cx = T(0.5) * (minX + maxX);
+    root.cy = T(0.5) * (minY + maxY);
+    root.half = T(0.5) * std::max(maxX - minX, maxY - minY) + T(1e-9);
+    nodeCount = 1;
+
+    buildNode(0, 0, field.count, 0);
+
+    // Store the bodies in tree order so leaves are contiguous
+    for (int k = 0; k < field.count; ++k)
+    {
+        int i = order[k];
+        px[k] = srcX[i];
+        py[k] = srcY[i];
+        pm[k] = srcM[i];
+    }
+}
+
+// Fills one node and splits it into its non-empty quadrants
+template <class T>
+void BarnesHut<T>::buildNode(int index, int first, int count, int depth)
+{
+    Node &node = nodes[index];
+    node.first = first;
+    node.count = count;
+    node.child = 0;
+    node.children = 0;
+
+    T mass = T(0), mx = T(0), my = T(0);
+
+    for (int k = first; k < first + count; ++k)
+    {
+        int i = order[k];
+        mass += srcM[i];
+        mx += srcM[i] * srcX[i];
+        my += srcM[i] * srcY[i];
+    }
+
+    node.mass = mass;
+    node.comX = (mass > T(0)) ? mx / mass : node.cx;
+    node.comY = (mass > T(0)) ? my / mass : node.cy;
+
+    if (count <= LeafSize || depth >= MaxDepth || nodeCount + 4 > static_cast<int>(nodes.size()))
+        return;
+
+    // Partition into south/north, then each half into west/east
+    const T cx = node.cx;
+    const T cy = node.cy;
+    int *begin = order.data() + first;
+    int *end = begin + count;
+    int *north = std::partition(begin, end, [&](int i) { return srcY[i] < cy; });
+    int *southEast = std::partition(begin, north, [&](int i) { return srcX[i] < cx; });
+    int *northEast = std::partition(north, end, [&](int i) { return srcX[i] < cx; });
+
+    int *bounds[5] = {begin, southEast, north, northEast, end};
+    const T h = T(0.5) * node.half;
+    const T offX[4] = {-h, h, -h, h};
+    const T offY[4] = {-h, -h, h, h};
+
+    node.child = nodeCount;
+
+    for (int q = 0; q < 4; ++q)
+    {
+        int n = static_cast<int>(bounds[q + 1] - bounds[q]);
+        if (n == 0)
+            continue;
+
+        Node &c = nodes[nodeCount++];
+        c.cx = cx + offX[q];
+        c.cy = cy + offY[q];
+        c.half = h;
+        c.first = static_cast<int>(bounds[q] - order.data());
+        c.count = n;
+        node.children++;
+    }
+
+    for (int c = node.child; c < node.child + node.children; ++c)
+        buildNode(c, nodes[c].first, nodes[c].count, depth + 1);
+}
+
+// Acceleration of the bodies [begin, end), results go to ax/ay[0, end - begin).
+// A cell is approximated by its center of mass when size / distance < theta and the
+// target lies outside of it. Softening follows max(softening, distance * softening).
+template <class T>
+void BarnesHut<T>::accelerate(const ForceField<T> &field, int begin, int end, T *ax, T *ay) const
+{
+    const T thetaSqr = static_cast<T>(theta * theta);
+
+    for (int t = begin; t < end; ++t)
+    {
+        const T tx = field.x[t];
+        const T ty = field.y[t];
+        T sx = T(0), sy = T(0);
+
+        int stack[MaxDepth * 4 + 4];
+        int top = 0;
+
+        if (nodeCount > 0)
+            stack[top++] = 0;
+
+        while (top > 0)
+        {
+            const Node &node = nodes[stack[--top]];
+
+            if (node.children == 0)
+            {
+                for (int k = node.first; k < node.first + node.count; ++k)
+                    pairAcceleration(tx, ty, px[k], py[k], pm[k], field.softSqr, sx, sy);
+                continue;
+            }
+
+            T dx = node.comX - tx;
+            T dy = node.comY - ty;
+            T size = T(2) * node.half;
+            bool inside = std::abs(tx - node.cx) <= node.half && std::abs(ty - node.cy) <= node.half;
+
+            if (!inside && size * size < thetaSqr * (dx * dx + dy * dy))
+            {
+                pairAcceleration(tx, ty, node.comX, node.comY, node.mass, field.softSqr, sx, sy);
+                continue;
+            }
+
+            for (int c = node.child; c < node.child + node.children; ++c)
+                stack[top++] = c;
+        }
+
+        // The black hole is a source only
+        pairAcceleration(tx, ty, field.holeX, field.holeY, field.holeMass, field.softSqr, sx, sy);
+
+        ax[t - begin] = field.G * sx;
+        ay[t - begin] = field.G * sy;
+    }
+}
+
+template class BarnesHut<float>;
+template class BarnesHut<double>;
@@ -0,0 +1,50 @@
+// BarnesHut.h – Quadtree force engine for large body counts
+// Distant groups of bodies are approximated by their center of mass, O(N log N) per step
+
+#ifndef BARNESHUT_H
+#define BARNESHUT_H
+
+#include <vector>
+#include "ForceKernel.h"
+
+template <class T>
+class BarnesHut
+{
+public:
+    BarnesHut();
+
+    static const int LeafSize = 8; // Bodies summed directly in a leaf
+    static const int MaxDepth = 32; // Depth limit, coincident bodies end up in one leaf
+
+    void reserve(int maxBodies);  // Preallocates the node arena, the tree never allocates afterwards
+    void setTheta(double theta);  // Opening angle, 0 is exact
+    double getTheta() const { return theta; }
+
+    void build(const ForceField<T> &field); // Rebuilds the tree for the current positions, resets the arena
+    void accelerate(const ForceField<T> &field, int begin, int end, T *ax, T *ay) const; // Acceleration of the bodies [begin, end)
+
+private:
+    struct Node
+    {
+        T comX, comY;   // Center of mass
+        T mass;         // Total mass
+        T cx, cy, half; // Cell center and half edge length
+        int first, count;    // Bodies of this cell in tree order
+        int child, children; // First child node and number of children, 0 for a leaf
+    };
+
+    void buildNode(int index, int first, int count, int depth); // Fills one node and splits it if needed
+
+    std::vector<Node> nodes;  // Node arena
+    int nodeCount;            // Used nodes in the arena
+    std::vector<int> order;   // Body indices in tree order
+    std::vector<T> px;        // Positions x in tree order
+    std::vector<T> py;        // Positions y in tree order
+    std::vector<T> pm;        // Masses in tree order
+    const T *srcX;            // Source positions x while building
+    const T *srcY;            // Source positions y while building
+    const T *srcM;            // Source masses while building
+    double theta;             // Opening angle
+};
+
+#endif // BARNESHUT_H
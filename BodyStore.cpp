@@ -0,0 +1,91 @@
+// BodyStore.cpp – Structure-of-arrays storage for body states
+
+#include <algorithm>
+#include <new>
+#include "BodyStore.h"
+#include "Platform.h"
+
+template <class T>
+BodyStore<T>::BodyStore()
+    : x(nullptr), y(nullptr), vx(nullptr), vy(nullptr), ax(nullptr), ay(nullptr), mass(nullptr), block(nullptr),
+      size(0), capacity(0)
+{
+}
+
+template <class T>
+BodyStore<T>::~BodyStore()
+{
+    alignedFree(block);
+}
+
+// Allocates zeroed storage for capacity bodies. The arrays are padded to whole cache lines,
+// so each of them is aligned like the block.
+template <class T>
+void BodyStore<T>::allocate(int capacity)
+{
+    const size_t lane = Alignment / sizeof(T);
+    const size_t stride = (static_cast<size_t>(capacity) + lane - 1) / lane * lane;
+
+    alignedFree(block);
+    size = stride * FieldCount;
+    block = static_cast<T *>(alignedAlloc(size * sizeof(T), Alignment));
+
+    if (block == nullptr)
+        throw std::bad_alloc();
+
+    this->capacity = capacity;
+    clear();
+
+    x = block;
+    y = block + stride;
+    vx = block + stride * 2;
+    vy = block + stride * 3;
+    ax = block + stride * 4;
+    ay = block + stride * 5;
+    mass = block + stride * 6;
+}
+
+// Zeroes every body value
+template <class T>
+void BodyStore<T>::clear()
+{
+    std::fill(block, block + size, T(0));
+}
+
+// Gathers one body from the arrays
+template <class T>
+Body<T> BodyStore<T>::get(int index) const
+{
+    Body<T> body;
+    body.x = x[index];
+    body.y = y[index];
+    body.vx = vx[index];
+    body.vy = vy[index];
+    body.ax = ax[index];
+    body.ay = ay[index];
+    body.mass = mass[index];
+    return body;
+}
+
+// Scatters one body into the arrays
+template <class T>
+void BodyStore<T>::set(int index, const Body<T> &body)
+{
+    x[index] = body.x;
+    y[index] = body.y;
+    vx[index] = body.vx;
+    vy[index] = body.vy;
+    ax[index] = body.ax;
+    ay[index] = body.ay;
+    mass[index] = body.mass;
+}
+
+// Copies all values from a store of the same capacity
+template <class T>
+void BodyStore<T>::copyFrom(const BodyStore &other)
+{
+    std::copy(other.block, other.block + other.size, block);
+}
+
+template class BodyStore<float>;
+template class BodyStore<double>;
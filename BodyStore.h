@@ -0,0 +1,55 @@
+// BodyStore.h – Structure-of-arrays storage for body states
+// Every body field lives in its own contiguous array so the force loop only touches what it needs
+
+#ifndef BODYSTORE_H
+#define BODYSTORE_H
+
+#include <cstddef>
+
+// Represents a single body in 2D space, T is the scalar type of the simulation core
+template <class T>
+struct Body
+{
+    T x, y;   // Position
+    T vx, vy; // Velocity
+    T ax, ay; // Acceleration
+    T mass;   // Mass
+};
+
+// Holds the state of all bodies as separate x/y/vx/vy/ax/ay/mass arrays
+template <class T>
+class BodyStore
+{
+public:
+    BodyStore();
+    ~BodyStore();
+
+    BodyStore(const BodyStore &) = delete;
+    BodyStore &operator=(const BodyStore &) = delete;
+
+    static const int FieldCount = 7;  // Number of arrays in the store
+    static const int Alignment = 64; // Every array starts on a cache line, a full AVX-512 register
+
+    void allocate(int capacity);            // Allocates zeroed, aligned storage for capacity bodies
+    void clear();                           // Zeroes every body value
+    Body<T> get(int index) const;             // Gathers one body from the arrays
+    void set(int index, const Body<T> &body); // Scatters one body into the arrays
+    void copyFrom(const BodyStore &other);  // Copies all values from a store of the same capacity
+
+    int getCapacity() const { return capacity; } // Number of bodies the store can hold
+
+    T *x;    // Positions x
+    T *y;    // Positions y
+    T *vx;   // Velocities x
+    T *vy;   // Velocities y
+    T *ax;   // Accelerations x
+    T *ay;   // Accelerations y
+    T *mass; // Masses
+
+private:
+    T *block;                  // Single aligned allocation holding all arrays back to back
+    size_t size;               // Scalars in block
+    int capacity;              // Number of bodies per array
+};
+
+#endif // BODYSTORE_H
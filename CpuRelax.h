@@ -0,0 +1,24 @@
+// CpuRelax.h – Busy-wait hint shared by the worker pool and the tick scheduler
+
+#ifndef CPURELAX_H
+#define CPURELAX_H
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Tells the CPU that we are busy waiting
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+#endif // CPURELAX_H
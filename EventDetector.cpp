@@ -0,0 +1,199 @@
+// EventDetector.cpp – Close encounters and black hole approaches at physics step resolution
+
+#include <algorithm>
+#include <cmath>
+#include "EventDetector.h"
+
+template <class T>
+EventDetector<T>::EventDetector()
+    : lastCount(0), encounterRadius(0), holeRadius(0), restart(false)
+{
+}
+
+// Preallocates the tables for maxBodies, detect() never allocates
+template <class T>
+void EventDetector<T>::reserve(int maxBodies)
+{
+    close.reserve(MaxPairs);
+    next.reserve(MaxPairs);
+    inHole.assign(maxBodies, 0);
+    lastX.assign(maxBodies, T(0));
+    lastY.assign(maxBodies, T(0));
+    lastCount = 0;
+}
+
+// Forgets all close pairs, applied by the next detect() on the simulation thread
+template <class T>
+void EventDetector<T>::clear()
+{
+    restart = true;
+}
+
+// Fraction of the step at which the distance crossed the radius, assuming it changed linearly
+template <class T>
+static T crossing(T before, T after, T radius)
+{
+    T span = before - after;
+    T f = span != T(0) ? (before - radius) / span : T(1);
+    return std::isfinite(f) ? std::max(T(0), std::min(T(1), f)) : T(1);
+}
+
+// Pairs closer than radius, sorted
+template <class T>
+void EventDetector<T>::findPairs(const BodyStore<T> &bodies, int count, const SpatialGrid<T> *grid, T radius)
+{
+    const T r2 = radius * radius;
+    next.clear();
+
+    if (grid != nullptr && radius <= grid->getCellSize())
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const T xi = bodies.x[i];
+            const T yi = bodies.y[i];
+
+            grid->forNeighbours(xi, yi, [&](int j)
+            {
+                if (j <= i || static_cast<int>(next.size()) == MaxPairs)
+                    return;
+
+                T dx = bodies.x[j] - xi;
+                T dy = bodies.y[j] - yi;
+
+                if (dx * dx + dy * dy < r2)
+                    next.push_back(key(i, j));
+            });
+        }
+
+        // Grid buckets come in hash order
+        std::sort(next.begin(), next.end());
+        return;
+    }
+
+    for (int i = 0; i < count - 1; ++i)
+    {
+        const T xi = bodies.x[i];
+        const T yi = bodies.y[i];
+
+        for (int j = i + 1; j < count; ++j)
+        {
+            T dx = bodies.x[j] - xi;
+            T dy = bodies.y[j] - yi;
+
+            if (dx * dx + dy * dy < r2 && static_cast<int>(next.size()) < MaxPairs)
+                next.push_back(key(i, j));
+        }
+    }
+}
+
+// Queues the pairs that entered or left the radius since the last step, then keeps the new pairs
+template <class T>
+void EventDetector<T>::emitPairs(const BodyStore<T> &bodies, int count, T radius, double time, T dt, EventQueue &queue)
+{
+    auto emit = [&](uint64_t k, EventType type)
+    {
+        int a = static_cast<int>(k >> 32);
+        int b = static_cast<int>(k & 0xffffffffu);
+
+        // Bodies that were not active in both steps have no crossing to report
+        if (a >= count || b >= count || a >= lastCount || b >= lastCount)
+            return;
+
+        T before = std::hypot(lastX[b] - lastX[a], lastY[b] - lastY[a]);
+        T after = std::hypot(bodies.x[b] - bodies.x[a], bodies.y[b] - bodies.y[a]);
+        T speed = std::hypot(bodies.vx[b] - bodies.vx[a], bodies.vy[b] - bodies.vy[a]);
+
+        queue.push(SimEvent{type, a, b, static_cast<float>(after), static_cast<float>(speed),
+                            time + static_cast<double>(crossing(before, after, radius) * dt)});
+    };
+
+    // Both lists are sorted, one merge finds the entries and the exits
+    size_t i = 0, j = 0;
+
+    while (i < close.size() || j < next.size())
+    {
+        if (j == next.size() || (i < close.size() && close[i] < next[j]))
+            emit(close[i++], EventType::Separation);
+        else if (i == close.size() || next[j] < close[i])
+            emit(next[j++], EventType::Encounter);
+        else
+        {
+            ++i;
+            ++j;
+        }
+    }
+
+    close.swap(next);
+}
+
+// Queues the bodies that entered or left the hole radius since the last step
+template <class T>
+void EventDetector<T>::detectHole(const BodyStore<T> &bodies, int count, const Body<T> &hole, T radius,
+                                  double time, T dt, EventQueue &queue)
+{
+    const T r2 = radius * radius;
+
+    for (int i = 0; i < count; ++i)
+    {
+        T dx = bodies.x[i] - hole.x;
+        T dy = bodies.y[i] - hole.y;
+        uint8_t inside = dx * dx + dy * dy < r2;
+
+        if (inside == inHole[i])
+            continue;
+
+        inHole[i] = inside;
+
+        if (i >= lastCount)
+            continue;
+
+        T before = std::hypot(lastX[i] - hole.x, lastY[i] - hole.y);
+        T after = std::hypot(dx, dy);
+        T speed = std::hypot(bodies.vx[i], bodies.vy[i]);
+
+        queue.push(SimEvent{inside ? EventType::HoleEnter : EventType::HoleLeave, i, -1, static_cast<float>(after),
+                            static_cast<float>(speed), time + static_cast<double>(crossing(before, after, radius) * dt)});
+    }
+}
+
+// Compares the positions after one step with those of the previous call and queues the crossings.
+// time is the simulated time at the start of the step.
+template <class T>
+void EventDetector<T>::detect(const BodyStore<T> &bodies, int count, const Body<T> &hole, const SpatialGrid<T> *grid,
+                              double time, T dt, EventQueue &queue)
+{
+    const T encounter = getEncounterRadius();
+    const T holeR = getHoleRadius();
+
+    if (encounter == 0 && holeR == 0 && lastCount == 0)
+        return;
+
+    // A reset moves the bodies without a step in between, nothing crossed anything
+    if (restart.exchange(false, std::memory_order_relaxed))
+        lastCount = 0;
+
+    if (encounter > 0)
+    {
+        findPairs(bodies, count, grid, encounter);
+        emitPairs(bodies, count, encounter, time, dt, queue);
+    }
+    else
+        close.clear();
+
+    if (holeR > 0)
+        detectHole(bodies, count, hole, holeR, time, dt, queue);
+    else
+        std::fill(inHole.begin(), inHole.end(), 0);
+
+    if (encounter > 0 || holeR > 0)
+    {
+        std::copy(bodies.x, bodies.x + count, lastX.begin());
+        std::copy(bodies.y, bodies.y + count, lastY.begin());
+        lastCount = count;
+    }
+    else
+        lastCount = 0;
+}
+
+template class EventDetector<float>;
+template class EventDetector<double>;
@@ -0,0 +1,57 @@
+// EventDetector.h – Close encounters and black hole approaches at physics step resolution
+// Runs inside every simulation step on the new positions. A pair or body that crosses its radius
+// between two steps is queued with the time of the crossing, interpolated from the distances
+// before and after the step, so events keep their order and spacing below the output frame rate.
+
+#ifndef EVENTDETECTOR_H
+#define EVENTDETECTOR_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "BodyStore.h"
+#include "SpatialGrid.h"
+#include "EventQueue.h"
+
+template <class T>
+class EventDetector
+{
+public:
+    static const int MaxPairs = 16384; // Close pairs tracked at once, further pairs get no events
+
+    EventDetector();
+
+    void reserve(int maxBodies); // Preallocates the tables for maxBodies
+    void clear();                // Forgets all close pairs, the next step only records the state. Thread-safe
+
+    void setEncounterRadius(T r) { encounterRadius = r > 0 ? r : 0; } // Pair distance of encounters, 0 off, thread-safe
+    void setHoleRadius(T r) { holeRadius = r > 0 ? r : 0; }           // Distance to the black hole, 0 off, thread-safe
+    T getEncounterRadius() const { return encounterRadius.load(std::memory_order_relaxed); }
+    T getHoleRadius() const { return holeRadius.load(std::memory_order_relaxed); }
+    bool enabled() const { return getEncounterRadius() > 0 || getHoleRadius() > 0; }
+
+    // Compares the positions after one step with those of the previous call and queues the crossings.
+    // grid is built from the current positions, nullptr or cells smaller than the radius check every pair.
+    void detect(const BodyStore<T> &bodies, int count, const Body<T> &hole, const SpatialGrid<T> *grid,
+                double time, T dt, EventQueue &queue);
+
+private:
+    static uint64_t key(int a, int b) { return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b); }
+
+    void findPairs(const BodyStore<T> &bodies, int count, const SpatialGrid<T> *grid, T radius);
+    void emitPairs(const BodyStore<T> &bodies, int count, T radius, double time, T dt, EventQueue &queue);
+    void detectHole(const BodyStore<T> &bodies, int count, const Body<T> &hole, T radius, double time, T dt, EventQueue &queue);
+
+    std::vector<uint64_t> close;   // Pairs a < b closer than the encounter radius after the last step, sorted
+    std::vector<uint64_t> next;    // Pairs of the current step, swapped with close
+    std::vector<uint8_t> inHole;   // Per body: inside the hole radius after the last step
+    std::vector<T> lastX;          // Positions after the last step
+    std::vector<T> lastY;
+    int lastCount;                 // Active bodies in the last step, 0 before the first step
+
+    std::atomic<T> encounterRadius; // Pair distance of encounters
+    std::atomic<T> holeRadius;      // Distance to the black hole
+    std::atomic<bool> restart;      // Set by clear(), the next step starts over
+};
+
+#endif // EVENTDETECTOR_H
@@ -0,0 +1,34 @@
+// EventQueue.h – Lock-free single-producer/single-consumer queue of simulation events
+// The simulation thread pushes the encounters it detects in every step, the output drains them.
+// Fixed capacity, pushing and draining never allocates or locks. A full queue drops new events.
+// Header only so every external of the project can read the events.
+
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include "SpscQueue.h"
+
+// Kinds of events detected by the simulation step
+enum class EventType
+{
+    Encounter,  // Two bodies came closer than the encounter radius
+    Separation, // Two bodies moved apart beyond the encounter radius
+    HoleEnter,  // A body came closer to the black hole than the hole radius
+    HoleLeave,  // A body moved away from the black hole beyond the hole radius
+};
+
+// One detected event
+struct SimEvent
+{
+    EventType type; // What happened
+    int a;          // Body index
+    int b;          // Second body index, -1 for black hole events
+    float distance; // Distance at the end of the step
+    float speed;    // Relative speed of the two bodies, speed of the body for black hole events
+    double time;    // Simulated time of the crossing, interpolated within the step
+};
+
+// 4096 events the output may fall behind
+typedef SpscQueue<SimEvent, 4096> EventQueue;
+
+#endif // EVENTQUEUE_H
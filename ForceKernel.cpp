@@ -0,0 +1,75 @@
+// ForceKernel.cpp – Generic kernel and runtime instruction set selection
+
+#include <cstring>
+#include "ForceKernel.h"
+#include "ForceKernelImpl.h"
+
+// Generic kernels, always available
+template <>
+const ForceKernel<float> *forceKernelScalar<float>()
+{
+    return makeKernel<ScalarOps<float>>("scalar");
+}
+
+template <>
+const ForceKernel<double> *forceKernelScalar<double>()
+{
+    return makeKernel<ScalarOps<double>>("scalar");
+}
+
+// Checks whether the CPU can execute a kernel
+template <class T>
+static bool cpuSupports(const ForceKernel<T> *kernel)
+{
+    if (kernel == nullptr)
+        return false;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (std::strcmp(kernel->name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+    if (std::strcmp(kernel->name, "avx512") == 0)
+        return __builtin_cpu_supports("avx512f");
+#endif
+
+    // NEON kernels are only built when the target guarantees NEON
+    return true;
+}
+
+// Fastest kernel supported by this CPU
+template <class T>
+const ForceKernel<T> *bestForceKernel()
+{
+    const ForceKernel<T> *candidates[] = {forceKernelAvx512<T>(), forceKernelAvx2<T>(), forceKernelNeon<T>()};
+
+    for (const ForceKernel<T> *kernel : candidates)
+    {
+        if (cpuSupports(kernel))
+            return kernel;
+    }
+
+    return forceKernelScalar<T>();
+}
+
+// Kernel by name, nullptr if unknown or unsupported
+template <class T>
+const ForceKernel<T> *findForceKernel(const char *name)
+{
+    if (std::strcmp(name, "auto") == 0)
+        return bestForceKernel<T>();
+
+    const ForceKernel<T> *candidates[] = {forceKernelScalar<T>(), forceKernelAvx2<T>(), forceKernelAvx512<T>(), forceKernelNeon<T>()};
+
+    for (const ForceKernel<T> *kernel : candidates)
+    {
+        if (kernel != nullptr && std::strcmp(kernel->name, name) == 0)
+            return cpuSupports(kernel) ? kernel : nullptr;
+    }
+
+    return nullptr;
+}
+
+template const ForceKernel<float> *bestForceKernel<float>();
+template const ForceKernel<double> *bestForceKernel<double>();
+template const ForceKernel<float> *findForceKernel<float>(const char *name);
+template const ForceKernel<double> *findForceKernel<double>(const char *name);
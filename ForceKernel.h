@@ -0,0 +1,70 @@
+// ForceKernel.h – Pairwise gravity kernels with runtime instruction set selection
+// The kernels work directly on the structure-of-arrays body store, T is the scalar type
+
+#ifndef FORCEKERNEL_H
+#define FORCEKERNEL_H
+
+// Everything a kernel needs to evaluate the gravitational field of the bodies
+template <class T>
+struct ForceField
+{
+    const T *x;    // Source positions x
+    const T *y;    // Source positions y
+    const T *mass; // Source masses
+    int count;     // Number of sources
+
+    T holeX;    // Black hole position x (one-sided source)
+    T holeY;    // Black hole position y
+    T holeMass; // Black hole mass, 0 disables it
+
+    T G;       // Gravitational constant
+    T softSqr; // Squared base softening
+};
+
+// Pairs closer than this (softened, squared) are ignored to avoid singularities
+static const double MinDistSqr = 0.0001;
+
+// One instruction set specific implementation
+template <class T>
+struct ForceKernel
+{
+    // Computes the acceleration of the targets [begin, end) caused by all sources and the black hole.
+    // Targets are read from the source arrays (index may exceed count), results go to ax/ay[0, end - begin).
+    typedef void (*DirectKernel)(const ForceField<T> &field, int begin, int end, T *ax, T *ay);
+
+    // Adds the pairs (i, j > i) of the rows [begin, end) to ax/ay[0, count), visiting each unordered
+    // pair once (Newton's third law). The caller zeroes the outputs and scales them by G afterwards.
+    typedef void (*SymmetricKernel)(const ForceField<T> &field, int begin, int end, T *ax, T *ay);
+
+    const char *name;          // Name used by the simd message
+    int width;                 // Interactions per instruction
+    DirectKernel direct;       // All-pairs evaluation for a range of targets
+    SymmetricKernel symmetric; // Half-pairs evaluation with equal and opposite contributions
+};
+
+template <class T>
+const ForceKernel<T> *bestForceKernel(); // Fastest kernel supported by this CPU
+template <class T>
+const ForceKernel<T> *findForceKernel(const char *name); // Kernel by name, nullptr if unknown or unsupported
+
+// Implementations, nullptr when the target was not built for this architecture
+template <class T>
+const ForceKernel<T> *forceKernelScalar();
+template <class T>
+const ForceKernel<T> *forceKernelAvx2();
+template <class T>
+const ForceKernel<T> *forceKernelAvx512();
+template <class T>
+const ForceKernel<T> *forceKernelNeon();
+
+// Every implementation file defines both precisions
+template <> const ForceKernel<float> *forceKernelScalar<float>();
+template <> const ForceKernel<double> *forceKernelScalar<double>();
+template <> const ForceKernel<float> *forceKernelAvx2<float>();
+template <> const ForceKernel<double> *forceKernelAvx2<double>();
+template <> const ForceKernel<float> *forceKernelAvx512<float>();
+template <> const ForceKernel<double> *forceKernelAvx512<double>();
+template <> const ForceKernel<float> *forceKernelNeon<float>();
+template <> const ForceKernel<double> *forceKernelNeon<double>();
+
+#endif // FORCEKERNEL_H
@@ -0,0 +1,113 @@
+// ForceKernelAvx2.cpp – 4-wide double and 8-wide single precision kernels for AVX2/FMA
+// Built with -mavx2 -mfma on x86_64, selected at runtime only if the CPU supports it
+
+#include "ForceKernel.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+#include "ForceKernelImpl.h"
+
+namespace
+{
+    struct Avx2Ops
+    {
+        typedef double Scalar;
+        typedef __m256d Vec;
+        static const int Width = 4;
+
+        static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+        static void subFrom(double *p, Vec v) { _mm256_storeu_pd(p, _mm256_sub_pd(_mm256_loadu_pd(p), v)); }
+        static Vec set1(double v) { return _mm256_set1_pd(v); }
+        static Vec zero() { return _mm256_setzero_pd(); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+
+        static double sum(Vec v)
+        {
+            __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            // 12 bit single precision estimate, three Newton steps reach double precision
+            const Vec half = _mm256_set1_pd(0.5);
+            const Vec threeHalves = _mm256_set1_pd(1.5);
+            Vec halfDist = _mm256_mul_pd(half, distSqr);
+            Vec invDist = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(distSqr)));
+            invDist = _mm256_mul_pd(invDist, _mm256_fnmadd_pd(halfDist, _mm256_mul_pd(invDist, invDist), threeHalves));
+            invDist = _mm256_mul_pd(invDist, _mm256_fnmadd_pd(halfDist, _mm256_mul_pd(invDist, invDist), threeHalves));
+            invDist = _mm256_mul_pd(invDist, _mm256_fnmadd_pd(halfDist, _mm256_mul_pd(invDist, invDist), threeHalves));
+            Vec w = _mm256_mul_pd(m, _mm256_mul_pd(invDist, _mm256_mul_pd(invDist, invDist)));
+            return _mm256_and_pd(w, _mm256_cmp_pd(distSqr, minSqr, _CMP_GE_OQ));
+        }
+    };
+
+    struct Avx2FloatOps
+    {
+        typedef float Scalar;
+        typedef __m256 Vec;
+        static const int Width = 8;
+
+        static Vec load(const float *p) { return _mm256_loadu_ps(p); }
+        static void subFrom(float *p, Vec v) { _mm256_storeu_ps(p, _mm256_sub_ps(_mm256_loadu_ps(p), v)); }
+        static Vec set1(float v) { return _mm256_set1_ps(v); }
+        static Vec zero() { return _mm256_setzero_ps(); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+
+        static float sum(Vec v)
+        {
+            __m128 quad = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            __m128 pair = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+            return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+        }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            // 12 bit estimate, one Newton step reaches single precision
+            const Vec half = _mm256_set1_ps(0.5f);
+            const Vec threeHalves = _mm256_set1_ps(1.5f);
+            Vec halfDist = _mm256_mul_ps(half, distSqr);
+            Vec invDist = _mm256_rsqrt_ps(distSqr);
+            invDist = _mm256_mul_ps(invDist, _mm256_fnmadd_ps(halfDist, _mm256_mul_ps(invDist, invDist), threeHalves));
+            Vec w = _mm256_mul_ps(m, _mm256_mul_ps(invDist, _mm256_mul_ps(invDist, invDist)));
+            return _mm256_and_ps(w, _mm256_cmp_ps(distSqr, minSqr, _CMP_GE_OQ));
+        }
+    };
+}
+
+template <>
+const ForceKernel<double> *forceKernelAvx2<double>()
+{
+    return makeKernel<Avx2Ops>("avx2");
+}
+
+template <>
+const ForceKernel<float> *forceKernelAvx2<float>()
+{
+    return makeKernel<Avx2FloatOps>("avx2");
+}
+
+#else
+
+template <>
+const ForceKernel<double> *forceKernelAvx2<double>()
+{
+    return nullptr;
+}
+
+template <>
+const ForceKernel<float> *forceKernelAvx2<float>()
+{
+    return nullptr;
+}
+
+#endif
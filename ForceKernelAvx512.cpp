@@ -0,0 +1,104 @@
+// ForceKernelAvx512.cpp – 8-wide double and 16-wide single precision kernels for AVX-512
+// Built with -mavx512f on x86_64, selected at runtime only if the CPU supports it
+
+#include "ForceKernel.h"
+
+#if defined(__AVX512F__)
+
+// GCC 12 reports its own _mm512_undefined_pd() placeholders as uninitialized
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+#include <immintrin.h>
+#include "ForceKernelImpl.h"
+
+namespace
+{
+    struct Avx512Ops
+    {
+        typedef double Scalar;
+        typedef __m512d Vec;
+        static const int Width = 8;
+
+        static Vec load(const double *p) { return _mm512_loadu_pd(p); }
+        static void subFrom(double *p, Vec v) { _mm512_storeu_pd(p, _mm512_sub_pd(_mm512_loadu_pd(p), v)); }
+        static Vec set1(double v) { return _mm512_set1_pd(v); }
+        static Vec zero() { return _mm512_setzero_pd(); }
+        static Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+        static Vec max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+        static double sum(Vec v) { return _mm512_reduce_add_pd(v); }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            // 14 bit estimate, two Newton steps reach double precision
+            const Vec half = _mm512_set1_pd(0.5);
+            const Vec threeHalves = _mm512_set1_pd(1.5);
+            Vec halfDist = _mm512_mul_pd(half, distSqr);
+            Vec invDist = _mm512_rsqrt14_pd(distSqr);
+            invDist = _mm512_mul_pd(invDist, _mm512_fnmadd_pd(halfDist, _mm512_mul_pd(invDist, invDist), threeHalves));
+            invDist = _mm512_mul_pd(invDist, _mm512_fnmadd_pd(halfDist, _mm512_mul_pd(invDist, invDist), threeHalves));
+            Vec w = _mm512_mul_pd(m, _mm512_mul_pd(invDist, _mm512_mul_pd(invDist, invDist)));
+            return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(distSqr, minSqr, _CMP_GE_OQ), w);
+        }
+    };
+
+    struct Avx512FloatOps
+    {
+        typedef float Scalar;
+        typedef __m512 Vec;
+        static const int Width = 16;
+
+        static Vec load(const float *p) { return _mm512_loadu_ps(p); }
+        static void subFrom(float *p, Vec v) { _mm512_storeu_ps(p, _mm512_sub_ps(_mm512_loadu_ps(p), v)); }
+        static Vec set1(float v) { return _mm512_set1_ps(v); }
+        static Vec zero() { return _mm512_setzero_ps(); }
+        static Vec sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+        static Vec max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+        static float sum(Vec v) { return _mm512_reduce_add_ps(v); }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            // 14 bit estimate, one Newton step reaches single precision
+            const Vec half = _mm512_set1_ps(0.5f);
+            const Vec threeHalves = _mm512_set1_ps(1.5f);
+            Vec halfDist = _mm512_mul_ps(half, distSqr);
+            Vec invDist = _mm512_rsqrt14_ps(distSqr);
+            invDist = _mm512_mul_ps(invDist, _mm512_fnmadd_ps(halfDist, _mm512_mul_ps(invDist, invDist), threeHalves));
+            Vec w = _mm512_mul_ps(m, _mm512_mul_ps(invDist, _mm512_mul_ps(invDist, invDist)));
+            return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(distSqr, minSqr, _CMP_GE_OQ), w);
+        }
+    };
+}
+
+template <>
+const ForceKernel<double> *forceKernelAvx512<double>()
+{
+    return makeKernel<Avx512Ops>("avx512");
+}
+
+template <>
+const ForceKernel<float> *forceKernelAvx512<float>()
+{
+    return makeKernel<Avx512FloatOps>("avx512");
+}
+
+#else
+
+template <>
+const ForceKernel<double> *forceKernelAvx512<double>()
+{
+    return nullptr;
+}
+
+template <>
+const ForceKernel<float> *forceKernelAvx512<float>()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,180 @@
+// ForceKernelImpl.h – Kernel templates shared by the instruction set specific translation units
+// Only include from .cpp files. Everything lives in an unnamed namespace so code compiled
+// with -mavx2/-mavx512f can never be merged into the generic build by the linker.
+
+#ifndef FORCEKERNELIMPL_H
+#define FORCEKERNELIMPL_H
+
+#include <cmath>
+#include "ForceKernel.h"
+
+namespace
+{
+    // Acceleration contribution of one source, branch free
+    template <class T>
+    inline void pairAcceleration(T tx, T ty, T ox, T oy, T om, T softSqr, T &ax, T &ay)
+    {
+        T dx = ox - tx;
+        T dy = oy - ty;
+        T r2 = dx * dx + dy * dy;
+
+        // max(s, r*s)^2 == s^2 * max(1, r^2), so the softening needs no sqrt of its own
+        T distSqr = r2 + softSqr * (r2 > T(1) ? r2 : T(1));
+        T invDist = T(1) / std::sqrt(distSqr);
+        T w = (distSqr >= T(MinDistSqr)) ? om * invDist * invDist * invDist : T(0);
+
+        ax += w * dx;
+        ay += w * dy;
+    }
+
+    // Width 1 operations, used for the generic build
+    template <class T>
+    struct ScalarOps
+    {
+        typedef T Scalar;
+        typedef T Vec;
+        static const int Width = 1;
+
+        static Vec load(const T *p) { return *p; }
+        static void subFrom(T *p, Vec v) { *p -= v; }
+        static Vec set1(T v) { return v; }
+        static Vec zero() { return T(0); }
+        static Vec sub(Vec a, Vec b) { return a - b; }
+        static Vec mul(Vec a, Vec b) { return a * b; }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return a * b + c; }
+        static Vec max(Vec a, Vec b) { return a > b ? a : b; }
+        static T sum(Vec v) { return v; }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            T invDist = T(1) / std::sqrt(distSqr);
+            return (distSqr >= minSqr) ? m * invDist * invDist * invDist : T(0);
+        }
+    };
+
+    // All-pairs acceleration of the targets [begin, end), Ops::Width interactions per step.
+    // Self-interaction needs no branch: dx = dy = 0 contributes nothing, and an unsoftened
+    // zero distance is removed by the MinDistSqr mask.
+    template <class Ops>
+    void directAcceleration(const ForceField<typename Ops::Scalar> &f, int begin, int end,
+                            typename Ops::Scalar *outAx, typename Ops::Scalar *outAy)
+    {
+        typedef typename Ops::Scalar T;
+        typedef typename Ops::Vec Vec;
+
+        const Vec one = Ops::set1(T(1));
+        const Vec softSqr = Ops::set1(f.softSqr);
+        const Vec minSqr = Ops::set1(T(MinDistSqr));
+        const int vectorEnd = f.count - f.count % Ops::Width;
+
+        for (int t = begin; t < end; ++t)
+        {
+            const T tx = f.x[t];
+            const T ty = f.y[t];
+            const Vec vtx = Ops::set1(tx);
+            const Vec vty = Ops::set1(ty);
+
+            Vec accX = Ops::zero();
+            Vec accY = Ops::zero();
+
+            for (int j = 0; j < vectorEnd; j += Ops::Width)
+            {
+                Vec dx = Ops::sub(Ops::load(f.x + j), vtx);
+                Vec dy = Ops::sub(Ops::load(f.y + j), vty);
+                Vec r2 = Ops::mulAdd(dy, dy, Ops::mul(dx, dx));
+                Vec distSqr = Ops::mulAdd(softSqr, Ops::max(one, r2), r2);
+                Vec w = Ops::weight(distSqr, Ops::load(f.mass + j), minSqr);
+
+                accX = Ops::mulAdd(w, dx, accX);
+                accY = Ops::mulAdd(w, dy, accY);
+            }
+
+            T ax = Ops::sum(accX);
+            T ay = Ops::sum(accY);
+
+            for (int j = vectorEnd; j < f.count; ++j)
+                pairAcceleration(tx, ty, f.x[j], f.y[j], f.mass[j], f.softSqr, ax, ay);
+
+            // The black hole is a source only, mass 0 contributes nothing
+            pairAcceleration(tx, ty, f.holeX, f.holeY, f.holeMass, f.softSqr, ax, ay);
+
+            outAx[t - begin] = f.G * ax;
+            outAy[t - begin] = f.G * ay;
+        }
+    }
+
+    // Half-pairs acceleration of the rows [begin, end). Each pair (i, j > i) is evaluated once,
+    // i gains m_j * d / r^3 and j loses m_i * d / r^3. The black hole only acts on the bodies.
+    // Sums are added to the outputs without G, so row ranges can be accumulated separately.
+    template <class Ops>
+    void symmetricAcceleration(const ForceField<typename Ops::Scalar> &f, int begin, int end,
+                               typename Ops::Scalar *outAx, typename Ops::Scalar *outAy)
+    {
+        typedef typename Ops::Scalar T;
+        typedef typename Ops::Vec Vec;
+
+        const Vec one = Ops::set1(T(1));
+        const Vec softSqr = Ops::set1(f.softSqr);
+        const Vec minSqr = Ops::set1(T(MinDistSqr));
+
+        for (int i = begin; i < end; ++i)
+        {
+            const T tx = f.x[i];
+            const T ty = f.y[i];
+            const T tm = f.mass[i];
+            const Vec vtx = Ops::set1(tx);
+            const Vec vty = Ops::set1(ty);
+            const Vec vtm = Ops::set1(tm);
+
+            Vec accX = Ops::zero();
+            Vec accY = Ops::zero();
+
+            int j = i + 1;
+            for (; j + Ops::Width <= f.count; j += Ops::Width)
+            {
+                Vec dx = Ops::sub(Ops::load(f.x + j), vtx);
+                Vec dy = Ops::sub(Ops::load(f.y + j), vty);
+                Vec r2 = Ops::mulAdd(dy, dy, Ops::mul(dx, dx));
+                Vec distSqr = Ops::mulAdd(softSqr, Ops::max(one, r2), r2);
+                Vec inv3 = Ops::weight(distSqr, one, minSqr);
+
+                Vec wi = Ops::mul(Ops::load(f.mass + j), inv3);
+                accX = Ops::mulAdd(wi, dx, accX);
+                accY = Ops::mulAdd(wi, dy, accY);
+
+                Vec wj = Ops::mul(vtm, inv3);
+                Ops::subFrom(outAx + j, Ops::mul(wj, dx));
+                Ops::subFrom(outAy + j, Ops::mul(wj, dy));
+            }
+
+            T ax = Ops::sum(accX);
+            T ay = Ops::sum(accY);
+
+            for (; j < f.count; ++j)
+            {
+                T jx = T(0), jy = T(0);
+                pairAcceleration(tx, ty, f.x[j], f.y[j], T(1), f.softSqr, jx, jy);
+                ax += f.mass[j] * jx;
+                ay += f.mass[j] * jy;
+                outAx[j] -= tm * jx;
+                outAy[j] -= tm * jy;
+            }
+
+            pairAcceleration(tx, ty, f.holeX, f.holeY, f.holeMass, f.softSqr, ax, ay);
+
+            outAx[i] += ax;
+            outAy[i] += ay;
+        }
+    }
+
+    // Kernel table entry of one Ops set
+    template <class Ops>
+    const ForceKernel<typename Ops::Scalar> *makeKernel(const char *name)
+    {
+        static const ForceKernel<typename Ops::Scalar> kernel = {name, Ops::Width, directAcceleration<Ops>, symmetricAcceleration<Ops>};
+        return &kernel;
+    }
+}
+
+#endif // FORCEKERNELIMPL_H
@@ -0,0 +1,163 @@
+// ForceKernelNeon.cpp – NEON kernels for ARM
+// Single precision: 4-wide on both aarch64 and armv7.
+// Double precision: aarch64 2-wide. armv7 (Organelle/Raspberry Pi) has no double lanes, so the
+// double kernel narrows positions on load and accumulates in float, results are widened back.
+
+#include "ForceKernel.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+#include "ForceKernelImpl.h"
+
+namespace
+{
+#if defined(__aarch64__)
+    struct NeonOps
+    {
+        typedef double Scalar;
+        typedef float64x2_t Vec;
+        static const int Width = 2;
+
+        static Vec load(const double *p) { return vld1q_f64(p); }
+        static void subFrom(double *p, Vec v) { vst1q_f64(p, vsubq_f64(vld1q_f64(p), v)); }
+        static Vec set1(double v) { return vdupq_n_f64(v); }
+        static Vec zero() { return vdupq_n_f64(0.0); }
+        static Vec sub(Vec a, Vec b) { return vsubq_f64(a, b); }
+        static Vec mul(Vec a, Vec b) { return vmulq_f64(a, b); }
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return vfmaq_f64(c, a, b); }
+        static Vec max(Vec a, Vec b) { return vmaxq_f64(a, b); }
+        static double sum(Vec v) { return vaddvq_f64(v); }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            Vec invDist = vdivq_f64(vdupq_n_f64(1.0), vsqrtq_f64(distSqr));
+            Vec w = vmulq_f64(m, vmulq_f64(invDist, vmulq_f64(invDist, invDist)));
+            uint64x2_t keep = vcgeq_f64(distSqr, minSqr);
+            return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(w), keep));
+        }
+    };
+#else
+    struct NeonOps
+    {
+        typedef double Scalar;
+        typedef float32x4_t Vec;
+        static const int Width = 4;
+
+        static Vec load(const double *p)
+        {
+            float narrow[4] = {static_cast<float>(p[0]), static_cast<float>(p[1]),
+                               static_cast<float>(p[2]), static_cast<float>(p[3])};
+            return vld1q_f32(narrow);
+        }
+
+        // Widens the lanes back to double so the accumulated values keep full precision
+        static void subFrom(double *p, Vec v)
+        {
+            float lanes[4];
+            vst1q_f32(lanes, v);
+            p[0] -= lanes[0];
+            p[1] -= lanes[1];
+            p[2] -= lanes[2];
+            p[3] -= lanes[3];
+        }
+
+        static Vec set1(double v) { return vdupq_n_f32(static_cast<float>(v)); }
+        static Vec zero() { return vdupq_n_f32(0.0f); }
+        static Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+        static Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+#if defined(__ARM_FEATURE_FMA)
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return vfmaq_f32(c, a, b); }
+#else
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return vmlaq_f32(c, a, b); }
+#endif
+        static Vec max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+
+        static double sum(Vec v)
+        {
+            float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+            return static_cast<double>(vget_lane_f32(vpadd_f32(pair, pair), 0));
+        }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise.
+        // armv7 has no vector sqrt/div: reciprocal sqrt estimate refined by two Newton steps.
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            Vec invDist = vrsqrteq_f32(distSqr);
+            invDist = vmulq_f32(invDist, vrsqrtsq_f32(vmulq_f32(distSqr, invDist), invDist));
+            invDist = vmulq_f32(invDist, vrsqrtsq_f32(vmulq_f32(distSqr, invDist), invDist));
+            Vec w = vmulq_f32(m, vmulq_f32(invDist, vmulq_f32(invDist, invDist)));
+            uint32x4_t keep = vcgeq_f32(distSqr, minSqr);
+            return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(w), keep));
+        }
+    };
+#endif
+
+    // Native single precision lanes, shared by aarch64 and armv7
+    struct NeonFloatOps
+    {
+        typedef float Scalar;
+        typedef float32x4_t Vec;
+        static const int Width = 4;
+
+        static Vec load(const float *p) { return vld1q_f32(p); }
+        static void subFrom(float *p, Vec v) { vst1q_f32(p, vsubq_f32(vld1q_f32(p), v)); }
+        static Vec set1(float v) { return vdupq_n_f32(v); }
+        static Vec zero() { return vdupq_n_f32(0.0f); }
+        static Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+        static Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+#if defined(__aarch64__) || defined(__ARM_FEATURE_FMA)
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return vfmaq_f32(c, a, b); }
+#else
+        static Vec mulAdd(Vec a, Vec b, Vec c) { return vmlaq_f32(c, a, b); }
+#endif
+        static Vec max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+
+        static float sum(Vec v)
+        {
+            float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+            return vget_lane_f32(vpadd_f32(pair, pair), 0);
+        }
+
+        // m / d^3 where d^2 is large enough, 0 otherwise.
+        // Reciprocal sqrt estimate refined by two Newton steps, armv7 has no vector sqrt/div.
+        static Vec weight(Vec distSqr, Vec m, Vec minSqr)
+        {
+            Vec invDist = vrsqrteq_f32(distSqr);
+            invDist = vmulq_f32(invDist, vrsqrtsq_f32(vmulq_f32(distSqr, invDist), invDist));
+            invDist = vmulq_f32(invDist, vrsqrtsq_f32(vmulq_f32(distSqr, invDist), invDist));
+            Vec w = vmulq_f32(m, vmulq_f32(invDist, vmulq_f32(invDist, invDist)));
+            uint32x4_t keep = vcgeq_f32(distSqr, minSqr);
+            return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(w), keep));
+        }
+    };
+}
+
+template <>
+const ForceKernel<double> *forceKernelNeon<double>()
+{
+    return makeKernel<NeonOps>("neon");
+}
+
+template <>
+const ForceKernel<float> *forceKernelNeon<float>()
+{
+    return makeKernel<NeonFloatOps>("neon");
+}
+
+#else
+
+template <>
+const ForceKernel<double> *forceKernelNeon<double>()
+{
+    return nullptr;
+}
+
+template <>
+const ForceKernel<float> *forceKernelNeon<float>()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,134 @@
+// FrameInterpolator.h – Output frames in between the physics frames of the snapshot ring
+// Keeps the last two physics frames and renders the state one physics interval in the past,
+// so the output can run at a much higher rate than the simulation. Consumer side only.
+
+#ifndef FRAMEINTERPOLATOR_H
+#define FRAMEINTERPOLATOR_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "SnapshotRing.h"
+
+// How output frames between two physics frames are computed
+enum class Interpolation
+{
+    Off,     // Only physics frames are output
+    Linear,  // Positions, velocities and accelerations blended linearly
+    Hermite, // Cubic Hermite positions from the velocities at both ends, velocities its derivative
+};
+
+class FrameInterpolator
+{
+public:
+    FrameInterpolator(int maxBodies)
+        : storage(static_cast<size_t>(maxBodies) * 3), filled(0)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            frame[k] = Snapshot{};
+            frame[k].bodies = &storage[static_cast<size_t>(k) * maxBodies];
+        }
+    }
+
+    FrameInterpolator(const FrameInterpolator &) = delete;
+    FrameInterpolator &operator=(const FrameInterpolator &) = delete;
+
+    // Forgets the stored frames, e.g. when the simulation restarts
+    void clear() { filled = 0; }
+
+    // Takes a new physics frame, the previous newest one becomes the start of the interval
+    void push(const Snapshot &next)
+    {
+        Snapshot &prev = frame[Prev];
+        Snapshot &cur = frame[Cur];
+        std::swap(prev.bodies, cur.bodies);
+        copyHeader(prev, cur);
+
+        copyHeader(cur, next);
+        for (int i = 0; i < next.count; ++i)
+            cur.bodies[i] = next.bodies[i];
+
+        if (filled < 2)
+            filled++;
+    }
+
+    // Frame for the steady_clock time now (ns), nullptr before the first push.
+    // Renders one interval behind the newest frame and holds the newest one when no new frame arrives.
+    const Snapshot *sample(int64_t now, Interpolation mode)
+    {
+        if (filled == 0)
+            return nullptr;
+
+        const Snapshot &prev = frame[Prev];
+        const Snapshot &cur = frame[Cur];
+
+        if (mode == Interpolation::Off || filled < 2 || prev.count != cur.count || cur.wall <= prev.wall)
+            return &cur;
+
+        double s = static_cast<double>(now - cur.wall) / static_cast<double>(cur.wall - prev.wall);
+        s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+
+        Snapshot &out = frame[Out];
+        copyHeader(out, cur);
+
+        double h = cur.time - prev.time;
+        bool hermite = mode == Interpolation::Hermite && h > 0.0;
+
+        // Cubic Hermite basis and its derivative
+        double s2 = s * s, s3 = s2 * s;
+        double h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s, h01 = -2 * s3 + 3 * s2, h11 = s3 - s2;
+        double d00 = 6 * s2 - 6 * s, d10 = 3 * s2 - 4 * s + 1, d01 = -d00, d11 = 3 * s2 - 2 * s;
+
+        for (int i = 0; i < cur.count; ++i)
+        {
+            const Body<Real> &a = prev.bodies[i];
+            const Body<Real> &b = cur.bodies[i];
+            Body<Real> &o = out.bodies[i];
+
+            if (hermite)
+            {
+                o.x = static_cast<Real>(h00 * a.x + h10 * h * a.vx + h01 * b.x + h11 * h * b.vx);
+                o.y = static_cast<Real>(h00 * a.y + h10 * h * a.vy + h01 * b.y + h11 * h * b.vy);
+                o.vx = static_cast<Real>((d00 * a.x + d01 * b.x) / h + d10 * a.vx + d11 * b.vx);
+                o.vy = static_cast<Real>((d00 * a.y + d01 * b.y) / h + d10 * a.vy + d11 * b.vy);
+            }
+            else
+            {
+                o.x = static_cast<Real>(a.x + (b.x - a.x) * s);
+                o.y = static_cast<Real>(a.y + (b.y - a.y) * s);
+                o.vx = static_cast<Real>(a.vx + (b.vx - a.vx) * s);
+                o.vy = static_cast<Real>(a.vy + (b.vy - a.vy) * s);
+            }
+
+            o.ax = static_cast<Real>(a.ax + (b.ax - a.ax) * s);
+            o.ay = static_cast<Real>(a.ay + (b.ay - a.ay) * s);
+            o.mass = b.mass;
+        }
+
+        return &out;
+    }
+
+private:
+    enum
+    {
+        Prev = 0, // Start of the interval
+        Cur = 1,  // Newest physics frame
+        Out = 2,  // Rendered frame
+    };
+
+    // Copies everything but the body pointer
+    static void copyHeader(Snapshot &to, const Snapshot &from)
+    {
+        Body<Real> *bodies = to.bodies;
+        to = from;
+        to.bodies = bodies;
+    }
+
+    std::vector<Body<Real>> storage; // Body arrays of the three frames
+    Snapshot frame[3];               // Prev, Cur, Out
+    int filled;                      // Physics frames pushed, up to 2
+};
+
+#endif // FRAMEINTERPOLATOR_H
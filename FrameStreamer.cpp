@@ -0,0 +1,188 @@
+// FrameStreamer.cpp – Binary UDP stream of simulation snapshots
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include "FrameStreamer.h"
+#include "grav.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int socket_t;
+#endif
+
+static const uint32_t Magic = 0x56415247; // "GRAV" in little endian
+static const uint16_t Version = 1;
+
+// Closes a socket handle of either platform
+static void closeSocket(intptr_t s)
+{
+#if defined(_WIN32)
+    closesocket(static_cast<socket_t>(s));
+#else
+    ::close(static_cast<socket_t>(s));
+#endif
+}
+
+// Appends one value to the datagram
+template <class V>
+static unsigned char *put(unsigned char *p, V value)
+{
+    std::memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+FrameStreamer::FrameStreamer()
+    : active(false), fields(FIELD_POS), scale(1.0f), sock(-1), addressLength(0)
+{
+#if defined(_WIN32)
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+}
+
+FrameStreamer::~FrameStreamer()
+{
+    close();
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+// Resolves the target and opens a non-blocking socket, the previous target is closed first
+bool FrameStreamer::open(const char *host, int port)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (sock >= 0)
+    {
+        active = false;
+        closeSocket(sock);
+        sock = -1;
+    }
+
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo *result = nullptr;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || result == nullptr)
+        return false;
+
+    intptr_t s = static_cast<intptr_t>(socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    bool ok = s >= 0 && result->ai_addrlen <= sizeof(address);
+
+    if (ok)
+    {
+        // A full socket buffer drops the frame, the simulation thread never blocks on the network
+#if defined(_WIN32)
+        u_long nonblocking = 1;
+        ioctlsocket(static_cast<socket_t>(s), FIONBIO, &nonblocking);
+#else
+        fcntl(static_cast<socket_t>(s), F_SETFL, fcntl(static_cast<socket_t>(s), F_GETFL, 0) | O_NONBLOCK);
+#endif
+        std::memcpy(address, result->ai_addr, result->ai_addrlen);
+        addressLength = static_cast<int>(result->ai_addrlen);
+        sock = s;
+        active = true;
+    }
+    else if (s >= 0)
+        closeSocket(s);
+
+    freeaddrinfo(result);
+    return ok;
+}
+
+// Stops streaming and closes the socket
+void FrameStreamer::close()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    active = false;
+
+    if (sock >= 0)
+    {
+        closeSocket(sock);
+        sock = -1;
+    }
+}
+
+// Encodes the frame into as many datagrams as it needs and sends them
+int FrameStreamer::send(const Snapshot &frame)
+{
+    if (!active.load(std::memory_order_relaxed))
+        return 0;
+
+    std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+    if (!guard.owns_lock() || sock < 0)
+        return 0;
+
+    int f = fields.load(std::memory_order_relaxed);
+    float k = scale.load(std::memory_order_relaxed);
+    int stride = ((f & FIELD_POS) ? 2 : 0) + ((f & FIELD_VEL) ? 2 : 0) + ((f & FIELD_ACC) ? 2 : 0) + ((f & FIELD_MASS) ? 1 : 0);
+    int perDatagram = stride > 0 ? (MaxDatagram - HeaderBytes) / (stride * static_cast<int>(sizeof(float))) : frame.count;
+    int sent = 0;
+    int first = 0;
+
+    // An empty frame still sends its header
+    do
+    {
+        int n = std::min(perDatagram, frame.count - first);
+        unsigned char *p = buffer;
+
+        p = put(p, Magic);
+        p = put(p, Version);
+        p = put(p, static_cast<uint16_t>(f));
+        p = put(p, static_cast<uint32_t>(frame.frame));
+        p = put(p, static_cast<uint32_t>(frame.count));
+        p = put(p, static_cast<uint32_t>(first));
+        p = put(p, static_cast<uint32_t>(n));
+        p = put(p, static_cast<float>(frame.time));
+        p = put(p, static_cast<float>(frame.hole.x) * k);
+        p = put(p, static_cast<float>(frame.hole.y) * k);
+        p = put(p, static_cast<float>(frame.hole.mass));
+
+        for (int i = first; i < first + n; ++i)
+        {
+            const Body<Real> &b = frame.bodies[i];
+
+            if (f & FIELD_POS)
+            {
+                p = put(p, static_cast<float>(b.x) * k);
+                p = put(p, static_cast<float>(b.y) * k);
+            }
+            if (f & FIELD_VEL)
+            {
+                p = put(p, static_cast<float>(b.vx) * k);
+                p = put(p, static_cast<float>(b.vy) * k);
+            }
+            if (f & FIELD_ACC)
+            {
+                p = put(p, static_cast<float>(b.ax) * k);
+                p = put(p, static_cast<float>(b.ay) * k);
+            }
+            if (f & FIELD_MASS)
+                p = put(p, static_cast<float>(b.mass));
+        }
+
+        int bytes = static_cast<int>(p - buffer);
+        if (sendto(static_cast<socket_t>(sock), reinterpret_cast<const char *>(buffer), bytes, 0,
+                   reinterpret_cast<const sockaddr *>(address), static_cast<socklen_t>(addressLength)) != bytes)
+            return -1;
+
+        sent++;
+        first += n;
+    } while (first < frame.count);
+
+    return sent;
+}
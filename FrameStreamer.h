@@ -0,0 +1,59 @@
+// FrameStreamer.h – Binary UDP stream of simulation snapshots, e.g. for the node visualizer
+// Frames are sent by the thread that publishes them, so nothing is formatted on the Pd thread.
+//
+// Datagram layout, little endian:
+//   0  char[4]  "GRAV"
+//   4  uint16   version (1)
+//   6  uint16   fields, GravField bits of the body values
+//   8  uint32   frame sequence number, consecutive unless frames were dropped
+//   12 uint32   bodies in the frame
+//   16 uint32   index of the first body in this datagram
+//   20 uint32   bodies in this datagram
+//   24 float    simulated time
+//   28 float    black hole x, y, mass
+//   40 float    per body: [x y] [vx vy] [ax ay] [m] as selected by fields
+// Large frames are split over several datagrams of the same sequence number.
+
+#ifndef FRAMESTREAMER_H
+#define FRAMESTREAMER_H
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "SnapshotRing.h"
+
+class FrameStreamer
+{
+public:
+    static const int HeaderBytes = 40;   // Bytes before the body values
+    static const int MaxDatagram = 1472; // UDP payload that fits a 1500 byte Ethernet MTU
+
+    FrameStreamer();
+    ~FrameStreamer();
+
+    FrameStreamer(const FrameStreamer &) = delete;
+    FrameStreamer &operator=(const FrameStreamer &) = delete;
+
+    bool open(const char *host, int port); // Resolves the target and opens the socket, false on failure
+    void close();                          // Stops streaming
+    bool isOpen() const { return active.load(std::memory_order_relaxed); }
+
+    void setFields(int f) { fields = f; } // GravField bits, thread-safe
+    void setScale(float s) { scale = s; } // Factor on positions, velocities and accelerations, thread-safe
+
+    // Sends one frame, returns the datagrams sent or -1 on a socket error.
+    // A frame arriving while open() or close() runs is skipped instead of waiting.
+    int send(const Snapshot &frame);
+
+private:
+    std::mutex lock;                       // Held while the socket is reconfigured
+    std::atomic<bool> active;              // A target is set
+    std::atomic<int> fields;               // Body values per datagram
+    std::atomic<float> scale;              // Output scale
+    intptr_t sock;                         // Socket handle, -1 when closed
+    alignas(8) unsigned char address[128]; // sockaddr of the target
+    int addressLength;                     // Bytes used in address
+    unsigned char buffer[MaxDatagram];     // Datagram being encoded
+};
+
+#endif // FRAMESTREAMER_H
@@ -1,18 +1,48 @@
 // g.cpp – Implementation of N-body gravitational simulation core
-// This file implements the g class defined in g.h
+// This file implements the g class defined in g.h, instantiated for float and double
 
 #include "Gravity.h"
-#include "GravityMath.h"
+#include "ForceKernelImpl.h"
 #include "m_pd.h" // For pd_error and post (Pure Data logging)
+#include <string>
+#include <cstring>
+#include <cmath>
 
 extern t_class *grav_class; // External reference for error logging
 
-Gravity::Gravity()
+// Set while a thread applies queued changes, the setters called by a preset then apply directly
+static thread_local bool applyingChanges = false;
+
+template <class T>
+Gravity<T>::Gravity(int maxBodies)
 {
-    math = new GravityMath();
+    max_bodies = std::max(DefaultMaxBodies, std::min(maxBodies, MaxBodyLimit));
     body_count = 3;
+    blackHole = Body<T>{};
+
+    bodies.allocate(max_bodies);
+    initBodies.allocate(max_bodies);
+    oldAx.assign(max_bodies, 0.0);
+    oldAy.assign(max_bodies, 0.0);
+    kernel = bestForceKernel<T>();
+    engine = ForceEngine::Direct;
+    integrator = Integrator::Leapfrog;
+    tolerance = DefaultTolerance;
+    rk_step = 0;
+    force_evaluations = 0;
+    tree.reserve(max_bodies);
+    grid.reserve(max_bodies);
+    grid_valid = false;
+    events.reserve(max_bodies);
+    requested_threads = 1;
+    deferred = false;
+    state_serial = 0;
     nudge_mode = false;
     nudge_step = 0;
+    step_count = 0;
+    sim_time = 0.0;
+    profiling = false;
+    profile = StepProfile{};
 
     initParams();
     loadPreset(0);
@@ -27,13 +57,14 @@ Gravity::Gravity()
 }
 
 // Destructor
-Gravity::~Gravity()
+template <class T>
+Gravity<T>::~Gravity()
 {
-    delete math;
 }
 
 // Initializes simulation parameters
-void Gravity::initParams()
+template <class T>
+void Gravity<T>::initParams()
 {
     G = 1.0;
     dt = 0.01;
@@ -45,17 +76,19 @@ void Gravity::initParams()
 }
 
 // Zeroes all body values
-void Gravity::resetBodies()
+template <class T>
+void Gravity<T>::resetBodies()
 {
-    for (int i = 0; i < BodyCount; ++i)
-    {
-        bodies[i] = Body{};
-        initBodies[i] = Body{};
-    }
+    bodies.clear();
+    initBodies.clear();
+    grid_valid = false;
+    events.clear();
+    rk_step = 0;
 }
 
 // Sets the gravity constant
-void Gravity::setG(double g)
+template <class T>
+void Gravity<T>::setG(double g)
 {
     if (g < 0.0 || g > 10.0)
     {
@@ -63,22 +96,24 @@ void Gravity::setG(double g)
         return;
     }
 
-    G = (g < 0.1f) ? 0.1 : g;
+    change(ParamChange{Param::G, 0, {g}, nullptr});
 }
 
 // Sets the delta time between two simulations steps
-void Gravity::setDt(double dt)
+template <class T>
+void Gravity<T>::setDt(double dt)
 {
     if (dt <= 0.0 || dt > 0.1)
     {
         pd_error(grav_class, "[grav] dt must be in (0.001, 0.1], got %f", dt);
         return;
     }
-    this->dt = dt;
+    change(ParamChange{Param::Dt, 0, {dt}, nullptr});
 }
 
 // Sets the position damping factor
-void Gravity::setPosDamping(double damp)
+template <class T>
+void Gravity<T>::setPosDamping(double damp)
 {
     if (damp < 0.0 || damp > 0.1)
     {
@@ -86,11 +121,12 @@ void Gravity::setPosDamping(double damp)
         return;
     }
 
-    pos_damping = damp / 10000;
+    change(ParamChange{Param::PosDamping, 0, {damp}, nullptr});
 }
 
 // Sets the velocity damping factor
-void Gravity::setVelDamping(double damp)
+template <class T>
+void Gravity<T>::setVelDamping(double damp)
 {
     if (damp < 0.0 || damp > 0.5)
     {
@@ -98,11 +134,12 @@ void Gravity::setVelDamping(double damp)
         return;
     }
 
-    vel_damping = damp;
+    change(ParamChange{Param::VelDamping, 0, {damp}, nullptr});
 }
 
 // Set base softening value to prevent singularities
-void Gravity::setSoftening(double s)
+template <class T>
+void Gravity<T>::setSoftening(double s)
 {
     if (s < 0.0 || s > 5.0)
     {
@@ -110,11 +147,12 @@ void Gravity::setSoftening(double s)
         return;
     }
 
-    softening = s;
+    change(ParamChange{Param::Softening, 0, {s}, nullptr});
 }
 
 // Set the minimal velocity
-void Gravity::setVmin(double v)
+template <class T>
+void Gravity<T>::setVmin(double v)
 {
     if (v < 0.1 || v > 1000.0)
     {
@@ -122,13 +160,12 @@ void Gravity::setVmin(double v)
         return;
     }
 
-    vmin = v;
-    if (vmax < v)
-        vmax = v;
+    change(ParamChange{Param::Vmin, 0, {v}, nullptr});
 }
 
 // Set the maximal velocity
-void Gravity::setVmax(double v)
+template <class T>
+void Gravity<T>::setVmax(double v)
 {
     if (v < 1.0 || v > 10000.0)
     {
@@ -136,30 +173,29 @@ void Gravity::setVmax(double v)
         return;
     }
 
-    vmax = v;
-
-    if (vmin > v)
-        vmin = v;
+    change(ParamChange{Param::Vmax, 0, {v}, nullptr});
 }
 
 // Sets the number of active bodies
-void Gravity::setBodyCount(int count)
+template <class T>
+void Gravity<T>::setBodyCount(int count)
 {
-    if (count < 2 || count > BodyCount)
+    if (count < 2 || count > max_bodies)
     {
-        pd_error(grav_class, "[grav] count must be between 2 and %d, got %d", BodyCount, count);
+        pd_error(grav_class, "[grav] count must be between 2 and %d, got %d", max_bodies, count);
         return;
     }
 
-    body_count = count;
+    change(ParamChange{Param::BodyCount, count, {}, nullptr});
 }
 
 // Sets a bodies mass at simulation time
-void Gravity::setBodyMass(int index, double mass)
+template <class T>
+void Gravity<T>::setBodyMass(int index, double mass)
 {
-    if (index < 0 || index > BodyCount - 1)
+    if (index < 0 || index > max_bodies - 1)
     {
-        pd_error(grav_class, "[grav] index must be between 0 and %d, got %d", BodyCount - 1, index);
+        pd_error(grav_class, "[grav] index must be between 0 and %d, got %d", max_bodies - 1, index);
         return;
     }
 
@@ -169,12 +205,12 @@ void Gravity::setBodyMass(int index, double mass)
         return;
     }
 
-    Body &body = bodies[index];
-    body.mass = mass;
+    change(ParamChange{Param::BodyMass, index, {mass}, nullptr});
 }
 
 // Sets position and mass for the black hole
-void Gravity::setBlackHole(double x, double y, double mass)
+template <class T>
+void Gravity<T>::setBlackHole(double x, double y, double mass)
 {
     if (x < -500 || x > 500)
     {
@@ -194,178 +230,857 @@ void Gravity::setBlackHole(double x, double y, double mass)
         return;
     }
 
-    blackHole.x = x;
-    blackHole.y = y;
-    blackHole.vx = 0;
-    blackHole.vy = 0;
-    blackHole.ax = 0;
-    blackHole.ay = 0;
+    change(ParamChange{Param::BlackHole, 0, {x, y, mass}, nullptr});
+}
+
+// Selects the force kernel by name, auto picks the best one for this CPU
+template <class T>
+bool Gravity<T>::setSimd(const char *name)
+{
+    const ForceKernel<T> *k = findForceKernel<T>(name);
+
+    if (k == nullptr)
+    {
+        pd_error(grav_class, "[grav] simd '%s' is unknown or not supported by this CPU, keeping %s", name, kernel->name);
+        return false;
+    }
+
+    change(ParamChange{Param::Simd, 0, {}, k});
+    return true;
+}
+
+// Selects the force engine by name
+template <class T>
+bool Gravity<T>::setEngine(const char *name)
+{
+    std::string n(name);
+    ForceEngine e;
+
+    if (n == "direct")
+        e = ForceEngine::Direct;
+    else if (n == "symmetric")
+        e = ForceEngine::Symmetric;
+    else if (n == "tree")
+        e = ForceEngine::Tree;
+    else
+    {
+        pd_error(grav_class, "[grav] unknown engine '%s': expecting direct, symmetric, tree", name);
+        return false;
+    }
+
+    change(ParamChange{Param::Engine, 0, {static_cast<double>(e)}, nullptr});
+    return true;
+}
+
+// Selects the integrator by name
+template <class T>
+bool Gravity<T>::setIntegrator(const char *name)
+{
+    std::string n(name);
+    Integrator i;
+
+    if (n == "leapfrog")
+        i = Integrator::Leapfrog;
+    else if (n == "yoshida4")
+        i = Integrator::Yoshida4;
+    else if (n == "rk45")
+        i = Integrator::RK45;
+    else if (n == "block")
+        i = Integrator::Block;
+    else
+    {
+        pd_error(grav_class, "[grav] unknown integrator '%s': expecting leapfrog, yoshida4, rk45, block", name);
+        return false;
+    }
+
+    change(ParamChange{Param::Integrator, 0, {static_cast<double>(i)}, nullptr});
+    return true;
+}
+
+// Sets the error per step the RK45 integrator keeps, relative to the size of the values
+template <class T>
+void Gravity<T>::setTolerance(double tolerance)
+{
+    if (tolerance < 1e-12 || tolerance > 0.01)
+    {
+        pd_error(grav_class, "[grav] tolerance must be in [1e-12, 0.01], got %g", tolerance);
+        return;
+    }
+
+    change(ParamChange{Param::Tolerance, 0, {tolerance}, nullptr});
+}
+
+// Sets the Barnes–Hut opening angle, 0 is exact, larger is faster and coarser
+template <class T>
+void Gravity<T>::setTheta(double theta)
+{
+    if (theta < 0.0 || theta > 2.0)
+    {
+        pd_error(grav_class, "[grav] theta must be in [0.0, 2.0], got %f", theta);
+        return;
+    }
+
+    change(ParamChange{Param::Theta, 0, {theta}, nullptr});
+}
+
+// Sets the number of threads sharing one simulation step. The pool is resized by the
+// simulation thread itself at the start of the next step, so no step is ever interrupted.
+template <class T>
+void Gravity<T>::setThreads(int count)
+{
+    if (count < 1 || count > WorkerPool::MaxThreads)
+    {
+        pd_error(grav_class, "[grav] threads must be between 1 and %d, got %d", WorkerPool::MaxThreads, count);
+        return;
+    }
+
+    requested_threads = count;
+}
+
+// Resizes the worker pool to the requested thread count
+template <class T>
+void Gravity<T>::applyThreadCount()
+{
+    int count = requested_threads;
+
+    if (count == pool.size())
+        return;
+
+    pool.resize(count);
+    scratch.assign(static_cast<size_t>(count - 1) * 2 * max_bodies, 0.0);
+}
+
+// Seeds the random generator of this instance, the same seed reproduces a run
+template <class T>
+void Gravity<T>::setSeed(int seed)
+{
+    if (seed < 0)
+    {
+        pd_error(grav_class, "[grav] seed must be >= 0, got %d", seed);
+        return;
+    }
 
-    blackHole.mass = mass;
+    change(ParamChange{Param::Seed, seed, {}, nullptr});
+}
+
+// Enables timing of the simulation phases, the profile starts from zero
+template <class T>
+void Gravity<T>::setProfiling(bool on)
+{
+    profiling = on;
+    profile = StepProfile{};
+}
+
+// Pair distance below which two bodies raise an encounter event, 0 disables encounters
+template <class T>
+void Gravity<T>::setEncounterRadius(double r)
+{
+    if (r < 0.0)
+    {
+        pd_error(grav_class, "[grav] encounter radius must be >= 0, got %f", r);
+        return;
+    }
+
+    events.setEncounterRadius(static_cast<T>(r));
+}
+
+// Distance to the black hole below which a body raises a hole event, 0 disables hole events
+template <class T>
+void Gravity<T>::setHoleRadius(double r)
+{
+    if (r < 0.0)
+    {
+        pd_error(grav_class, "[grav] hole radius must be >= 0, got %f", r);
+        return;
+    }
+
+    events.setHoleRadius(static_cast<T>(r));
+}
+
+// Gets the name of the active force engine
+template <class T>
+const char *Gravity<T>::getEngine() const
+{
+    switch (engine)
+    {
+    case ForceEngine::Symmetric:
+        return "symmetric";
+    case ForceEngine::Tree:
+        return "tree";
+    default:
+        return "direct";
+    }
+}
+
+// Gets the name of the active integrator
+template <class T>
+const char *Gravity<T>::getIntegrator() const
+{
+    switch (integrator)
+    {
+    case Integrator::Yoshida4:
+        return "yoshida4";
+    case Integrator::RK45:
+        return "rk45";
+    case Integrator::Block:
+        return "block";
+    default:
+        return "leapfrog";
+    }
 }
 
 // Gets the body with a given index
-const Body &Gravity::getBody(int index) const
+template <class T>
+Body<T> Gravity<T>::getBody(int index) const
 {
-    if (index < 0 || index > BodyCount - 1)
+    if (index < 0 || index > max_bodies - 1)
     {
-        pd_error(grav_class, "[grav] index must be between 0 and %d, got %d => 1. body returned", BodyCount - 1, index);
-        return bodies[0];
+        pd_error(grav_class, "[grav] index must be between 0 and %d, got %d => 1. body returned", max_bodies - 1, index);
+        return bodies.get(0);
     }
 
-    return bodies[index];
+    return bodies.get(index);
+}
+
+// Returns a copy of all active body states for thread safety
+template <class T>
+std::vector<Body<T>> Gravity<T>::getBodies() const
+{
+    std::vector<Body<T>> copy(body_count);
+
+    for (int i = 0; i < body_count; ++i)
+        copy[i] = bodies.get(i);
+
+    return copy;
 }
 
-// Returns a copy of all current body states for thread safety
-std::vector<Body> Gravity::getBodies() const
+// Copies the active bodies to out (at least getBodyCount() entries) without allocating
+template <class T>
+int Gravity<T>::copyBodies(Body<T> *out) const
 {
-    return std::vector<Body>(bodies, bodies + BodyCount); // std::vector<Body>
+    for (int i = 0; i < body_count; ++i)
+        out[i] = bodies.get(i);
+
+    return body_count;
 }
 
 // Gets the body with a given index
-const Body &Gravity::getInitBody(int index) const
+template <class T>
+Body<T> Gravity<T>::getInitBody(int index) const
 {
-    if (index < 0 || index > BodyCount - 1)
+    if (index < 0 || index > max_bodies - 1)
     {
-        pd_error(grav_class, "[grav] nr must be between 0 and %d, got %d => 1. body returned", BodyCount - 1, index);
-        return initBodies[0];
+        pd_error(grav_class, "[grav] nr must be between 0 and %d, got %d => 1. body returned", max_bodies - 1, index);
+        return initBodies.get(0);
     }
 
-    return initBodies[index];
+    return initBodies.get(index);
 }
 
 // initializes a bodies starting values
-void Gravity::initBody(int index)
+template <class T>
+void Gravity<T>::initBody(int index)
 {
-    Body &body = bodies[index];
-
     // Compute initial acceleration from all other bodies
-    Vector v = computeAcceleration(index);
+    Vector<T> v = computeAcceleration(index);
 
     // Calculate distance to origin to appy position damping
-    double pdamp = math->calcPositionDamping(body.x, body.y, pos_damping);
-    body.ax = v.x - body.x * pdamp;
-    body.ay = v.y - body.y * pdamp;
+    T bx = bodies.x[index];
+    T by = bodies.y[index];
+    T pdamp = math.calcPositionDamping(bx, by, pos_damping);
+    bodies.ax[index] = v.x - bx * pdamp;
+    bodies.ay[index] = v.y - by * pdamp;
 }
 
-void Gravity::setBody(int index, double x, double y, double vx, double vy, double mass)
+template <class T>
+void Gravity<T>::setBody(int index, double x, double y, double vx, double vy, double mass)
 {
     // Validate index range to avoid out-of-bounds access
-    if (index < 0 || index > BodyCount - 1)
+    if (index < 0 || index > max_bodies - 1)
         return;
 
-    Body &body = bodies[index];
-    Body &iBody = initBodies[index];
+    change(ParamChange{Param::Body, index, {x, y, vx, vy, mass}, nullptr});
+}
+
+// resets the bodies to init values
+template <class T>
+void Gravity<T>::reset()
+{
+    change(ParamChange{Param::Reset, 0, {}, nullptr});
+}
+
+template <class T>
+void Gravity<T>::applyReset()
+{
+    for (int i = 0; i < max_bodies; ++i)
+    {
+        bodies.x[i] = initBodies.x[i];
+        bodies.y[i] = initBodies.y[i];
+        bodies.vx[i] = initBodies.vx[i];
+        bodies.vy[i] = initBodies.vy[i];
+        bodies.ax[i] = initBodies.ax[i];
+        bodies.ay[i] = initBodies.ay[i];
+    }
+
+    grid_valid = false;
+    events.clear();
+    rk_step = 0;
 
-    body.x = x;
-    body.y = y;
-    body.vx = vx;
-    body.vy = vy;
-    body.mass = mass;
+    for (int i = 0; i < body_count; ++i)
+        initBody(i);
+}
 
-    iBody.x = x;
-    iBody.y = y;
-    iBody.vx = vx;
-    iBody.vy = vy;
-    iBody.mass = mass;
-    iBody.ax = 0;
-    iBody.ay = 0;
+// Bytes saveState() writes for the active bodies
+template <class T>
+size_t Gravity<T>::getStateSize() const
+{
+    return gravityStateSize(body_count, sizeof(T));
+}
 
-    initBody(index);
+// The arrays of a store in the order of the state layout
+template <class T>
+static void stateFields(const BodyStore<T> &store, T *(&fields)[BodyStore<T>::FieldCount])
+{
+    fields[0] = store.x;
+    fields[1] = store.y;
+    fields[2] = store.vx;
+    fields[3] = store.vy;
+    fields[4] = store.ax;
+    fields[5] = store.ay;
+    fields[6] = store.mass;
 }
 
-// resets the bodies to init values
-void Gravity::reset()
+// Reads count scalars of size bytes each into out, converting between float and double
+template <class T>
+static const unsigned char *readScalars(const unsigned char *p, uint32_t size, uint32_t count, T *out)
 {
-    for (int i = 0; i < 10; ++i)
+    if (size == sizeof(T))
     {
-        Body &body = bodies[i];
-        Body &iBody = initBodies[i];
+        std::memcpy(out, p, count * sizeof(T));
+    }
+    else if (size == sizeof(float))
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float v;
+            std::memcpy(&v, p + i * sizeof(float), sizeof(float));
+            out[i] = static_cast<T>(v);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            double v;
+            std::memcpy(&v, p + i * sizeof(double), sizeof(double));
+            out[i] = static_cast<T>(v);
+        }
+    }
 
-        body.x = iBody.x;
-        body.y = iBody.y;
-        body.vx = iBody.vx;
-        body.vy = iBody.vy;
-        body.ax = iBody.ax;
-        body.ay = iBody.ay;
+    return p + static_cast<size_t>(count) * size;
+}
 
-        initBody(i);
+// Writes the complete state: bodies, initial bodies, black hole, parameters and the random generator
+template <class T>
+size_t Gravity<T>::saveState(void *out, size_t size) const
+{
+    const size_t bytes = getStateSize();
+
+    if (size < bytes)
+        return 0;
+
+    GravityStateHeader h{};
+    h.magic = GravityStateMagic;
+    h.version = GravityStateVersion;
+    h.realSize = sizeof(T);
+    h.count = body_count;
+    h.engine = static_cast<uint32_t>(engine);
+    h.integrator = static_cast<uint32_t>(integrator);
+    h.nudgeMode = nudge_mode ? 1 : 0;
+    h.nudgeStep = nudge_step;
+    h.step = step_count;
+    h.time = sim_time;
+    h.G = G;
+    h.dt = dt;
+    h.posDamping = pos_damping;
+    h.velDamping = vel_damping;
+    h.softening = softening;
+    h.vmin = vmin;
+    h.vmax = vmax;
+    h.theta = tree.getTheta();
+    h.tolerance = tolerance;
+    h.rkStep = rk_step;
+    h.holeX = blackHole.x;
+    h.holeY = blackHole.y;
+    h.holeMass = blackHole.mass;
+    math.saveRandom(h.random);
+
+    unsigned char *p = static_cast<unsigned char *>(out);
+    std::memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+
+    for (const BodyStore<T> *store : {&bodies, &initBodies})
+    {
+        T *fields[BodyStore<T>::FieldCount];
+        stateFields(*store, fields);
+
+        for (T *field : fields)
+        {
+            std::memcpy(p, field, body_count * sizeof(T));
+            p += body_count * sizeof(T);
+        }
+    }
+
+    return bytes;
+}
+
+// Restores a state of saveState(). Everything is validated before the first value changes, so a
+// rejected state leaves the running system untouched. While deferred the state is copied and
+// restored by the simulation thread before its next step.
+template <class T>
+bool Gravity<T>::loadState(const void *data, size_t size)
+{
+    if (!checkState(data, size))
+        return false;
+
+    if (deferred.load() && !applyingChanges)
+    {
+        // The state lands in the mailbox, its place among the other changes is kept by the queue
+        std::vector<unsigned char> &copy = incomingState.fill();
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        copy.assign(bytes, bytes + size);
+        incomingState.publish(++state_serial);
+        change(ParamChange{Param::State, 0, {static_cast<double>(state_serial)}, nullptr});
+    }
+    else
+        restoreState(data);
+
+    return true;
+}
+
+// Finite and within [lo, hi]
+static bool inRange(double v, double lo, double hi)
+{
+    return std::isfinite(v) && v >= lo && v <= hi;
+}
+
+template <class T>
+bool Gravity<T>::checkState(const void *data, size_t size) const
+{
+    GravityStateHeader h;
+
+    if (size < sizeof(h))
+    {
+        pd_error(grav_class, "[grav] state is too short (%d bytes)", static_cast<int>(size));
+        return false;
+    }
+
+    std::memcpy(&h, data, sizeof(h));
+
+    if (h.magic != GravityStateMagic || h.version != GravityStateVersion)
+    {
+        pd_error(grav_class, "[grav] not a state of this version (expecting version %u)", GravityStateVersion);
+        return false;
+    }
+
+    if ((h.realSize != sizeof(float) && h.realSize != sizeof(double)) || size < gravityStateSize(h.count, h.realSize))
+    {
+        pd_error(grav_class, "[grav] state is truncated or damaged");
+        return false;
+    }
+
+    if (h.count < 2 || static_cast<int>(h.count) > max_bodies)
+    {
+        pd_error(grav_class, "[grav] state has %u bodies, this [grav] holds %d", h.count, max_bodies);
+        return false;
+    }
+
+    // The parameters keep the ranges of their setters as applied, posDamping as stored (the default
+    // 0.003 is stored as is, the setter divides by 10000), vmax never below vmin and the RK45 substep
+    // grown to at most 5 dt
+    bool valid = inRange(h.G, 0.1, 10.0) && h.dt > 0.0 && inRange(h.dt, 0.0, 0.1) &&
+                 inRange(h.posDamping, 0.0, 0.1) && inRange(h.velDamping, 0.0, 0.5) &&
+                 inRange(h.softening, 0.0, 5.0) && inRange(h.vmin, 0.1, 1000.0) && inRange(h.vmax, 1.0, 10000.0) &&
+                 h.vmin <= h.vmax && inRange(h.theta, 0.0, 2.0) && inRange(h.tolerance, 1e-12, 0.01) &&
+                 inRange(h.rkStep, 0.0, 0.5) && h.nudgeStep <= 20 && std::isfinite(h.time) &&
+                 std::isfinite(h.holeX) && std::isfinite(h.holeY) && std::isfinite(h.holeMass);
+
+    if (!valid)
+    {
+        pd_error(grav_class, "[grav] state has parameters out of range or not finite, damaged");
+        return false;
+    }
+
+    return true;
+}
+
+template <class T>
+void Gravity<T>::restoreState(const void *data)
+{
+    GravityStateHeader h;
+    std::memcpy(&h, data, sizeof(h));
+
+    // Bodies beyond the count are zeroed like a preset leaves them
+    bodies.clear();
+    initBodies.clear();
+
+    const unsigned char *p = static_cast<const unsigned char *>(data) + sizeof(h);
+
+    for (BodyStore<T> *store : {&bodies, &initBodies})
+    {
+        T *fields[BodyStore<T>::FieldCount];
+        stateFields(*store, fields);
+
+        for (T *field : fields)
+            p = readScalars(p, h.realSize, h.count, field);
+    }
+
+    body_count = h.count;
+    engine = h.engine <= static_cast<uint32_t>(ForceEngine::Tree) ? static_cast<ForceEngine>(h.engine) : ForceEngine::Direct;
+    integrator = h.integrator <= static_cast<uint32_t>(Integrator::Block) ? static_cast<Integrator>(h.integrator)
+                                                                         : Integrator::Leapfrog;
+    nudge_mode = h.nudgeMode != 0;
+    nudge_step = static_cast<int>(h.nudgeStep);
+    step_count = h.step;
+    sim_time = h.time;
+    G = h.G;
+    dt = h.dt;
+    pos_damping = h.posDamping;
+    vel_damping = h.velDamping;
+    softening = h.softening;
+    vmin = h.vmin;
+    vmax = h.vmax;
+    tree.setTheta(h.theta);
+    tolerance = h.tolerance;
+    rk_step = h.rkStep;
+    blackHole = Body<T>{};
+    blackHole.x = h.holeX;
+    blackHole.y = h.holeY;
+    blackHole.mass = h.holeMass;
+    math.loadRandom(h.random);
+
+    grid_valid = false;
+    events.clear();
+}
+
+// Applies a validated change now, or queues it while another thread steps the system
+template <class T>
+void Gravity<T>::change(const ParamChange &c)
+{
+    if (deferred.load() && !applyingChanges)
+        changes.push(c);
+    else
+        applyChange(c);
+}
+
+// Queues the setters from now on, or applies them directly again after applying what is pending
+template <class T>
+void Gravity<T>::setDeferred(bool on)
+{
+    deferred = on;
+
+    if (!on)
+        applyChanges();
+}
+
+// Applies the queued changes and states in the order they were made
+template <class T>
+void Gravity<T>::applyChanges()
+{
+    const ParamChange *c = changes.peek();
+
+    // Most steps find nothing, they only pay the load above
+    if (c == nullptr)
+        return;
+
+    applyingChanges = true;
+
+    for (; c != nullptr; c = changes.peek())
+    {
+        applyChange(*c);
+        changes.pop();
+    }
+
+    applyingChanges = false;
+}
+
+template <class T>
+void Gravity<T>::applyChange(const ParamChange &c)
+{
+    const double *v = c.value;
+
+    switch (c.param)
+    {
+    case Param::G:
+        G = (v[0] < 0.1) ? 0.1 : v[0];
+        break;
+    case Param::Dt:
+        dt = v[0];
+        break;
+    case Param::PosDamping:
+        pos_damping = v[0] / 10000;
+        break;
+    case Param::VelDamping:
+        vel_damping = v[0];
+        break;
+    case Param::Softening:
+        softening = v[0];
+        break;
+    case Param::Vmin:
+        vmin = v[0];
+        if (vmax < vmin)
+            vmax = vmin;
+        break;
+    case Param::Vmax:
+        vmax = v[0];
+        if (vmin > vmax)
+            vmin = vmax;
+        break;
+    case Param::Theta:
+        tree.setTheta(v[0]);
+        break;
+    case Param::Tolerance:
+        tolerance = v[0];
+        break;
+    case Param::Engine:
+        engine = static_cast<ForceEngine>(static_cast<int>(v[0]));
+        break;
+    case Param::Integrator:
+        integrator = static_cast<Integrator>(static_cast<int>(v[0]));
+        break;
+    case Param::Simd:
+        kernel = static_cast<const ForceKernel<T> *>(c.kernel);
+        break;
+    case Param::Seed:
+        math.seed(static_cast<uint64_t>(c.index));
+        break;
+    case Param::Nudge:
+        nudge_mode = true;
+        break;
+    case Param::BodyCount:
+        applyBodyCount(c.index);
+        break;
+    case Param::BodyMass:
+        // Only the pull of the body changes, by the mass difference
+        if (c.index < body_count)
+            addPull(bodies.x[c.index], bodies.y[c.index], T(v[0]) - bodies.mass[c.index], c.index, 0, body_count);
+        bodies.mass[c.index] = v[0];
+        break;
+    case Param::Body:
+    {
+        T values[5];
+        for (int i = 0; i < 5; ++i)
+            values[i] = v[i];
+        applyBody(c.index, values);
+        break;
+    }
+    case Param::BlackHole:
+        addPull(blackHole.x, blackHole.y, -blackHole.mass, -1, 0, body_count);
+        blackHole = Body<T>{};
+        blackHole.x = v[0];
+        blackHole.y = v[1];
+        blackHole.mass = v[2];
+        addPull(blackHole.x, blackHole.y, blackHole.mass, -1, 0, body_count);
+        break;
+    case Param::Preset:
+        applyPreset(c.index);
+        break;
+    case Param::Reset:
+        applyReset();
+        break;
+    case Param::State:
+        // A newer state than this entry's is restored by its own, later entry, which overrides
+        // everything queued in between anyway
+        incomingState.take();
+        if (incomingState.currentSerial() == static_cast<uint64_t>(v[0]))
+            restoreState(incomingState.current().data());
+        break;
     }
 }
 
+// Adds the pull of a point mass at x, y to the accelerations of the bodies [begin, end) except skip.
+// A negative mass takes a pull away again, so a change costs O(n) instead of a full O(n²) pass.
+template <class T>
+void Gravity<T>::addPull(T x, T y, T mass, int skip, int begin, int end)
+{
+    if (mass == T(0))
+        return;
+
+    const T softSqr = softening * softening;
+
+    for (int i = begin; i < end; ++i)
+    {
+        if (i == skip)
+            continue;
+
+        T ax = 0;
+        T ay = 0;
+        pairAcceleration(bodies.x[i], bodies.y[i], x, y, mass, softSqr, ax, ay);
+        bodies.ax[i] += G * ax;
+        bodies.ay[i] += G * ay;
+    }
+}
+
+// Replaces one body: its old pull on the others is taken away, the new one added and only
+// the acceleration of the body itself is evaluated in full
+template <class T>
+void Gravity<T>::applyBody(int index, const T *values)
+{
+    if (index < body_count)
+        addPull(bodies.x[index], bodies.y[index], -bodies.mass[index], index, 0, body_count);
+
+    bodies.x[index] = values[0];
+    bodies.y[index] = values[1];
+    bodies.vx[index] = values[2];
+    bodies.vy[index] = values[3];
+    bodies.mass[index] = values[4];
+
+    Body<T> iBody{};
+    iBody.x = values[0];
+    iBody.y = values[1];
+    iBody.vx = values[2];
+    iBody.vy = values[3];
+    iBody.mass = values[4];
+    initBodies.set(index, iBody);
+    grid_valid = false;
+
+    if (index < body_count)
+    {
+        addPull(values[0], values[1], values[4], index, 0, body_count);
+        initBody(index);
+    }
+}
+
+// Changes the active body count. Added bodies pull on the old ones and get their own
+// acceleration, removed bodies stop pulling.
+template <class T>
+void Gravity<T>::applyBodyCount(int count)
+{
+    int old = body_count;
+
+    for (int i = old; i < count; ++i)
+        addPull(bodies.x[i], bodies.y[i], bodies.mass[i], -1, 0, old);
+
+    for (int i = count; i < old; ++i)
+        addPull(bodies.x[i], bodies.y[i], -bodies.mass[i], -1, 0, count);
+
+    body_count = count;
+    grid_valid = false;
+
+    for (int i = old; i < count; ++i)
+        initBody(i);
+}
+
 // Gets the black hole
-const Body &Gravity::getBlackHole() const
+template <class T>
+const Body<T> &Gravity<T>::getBlackHole() const
 {
     return blackHole;
 }
 
 // Nudges the Bodies when they got stuck
-void Gravity::nudge()
+template <class T>
+void Gravity<T>::nudge()
 {
-    nudge_mode = true;
+    change(ParamChange{Param::Nudge, 0, {}, nullptr});
 }
 
 // Computes a reduced time step when bodies get very close to each other.
 // Ensures more simulation detail during close encounters.
-double Gravity::computeAdaptiveDt() const
+template <class T>
+T Gravity<T>::computeAdaptiveDt() const
 {
-    double minDist = std::numeric_limits<double>::max();
+    T minDist = std::numeric_limits<T>::max();
 
-    for (int i = 0; i < body_count; ++i)
+    if (useGrid())
     {
-        for (int j = i + 1; j < body_count; ++j)
+        // Searched out to GridMaxCellSize, tanh(0.8 * 8) is within 6e-6 of 1, so the step
+        // matches the all-pairs scan below
+        minDist = grid.minDistance(T(GridMaxCellSize));
+    }
+    else
+    {
+        for (int i = 0; i < body_count; ++i)
         {
-            double dist = math->calcEuclideanDistance(bodies[i].x, bodies[i].y, bodies[j].x, bodies[j].y);
-            if (dist < minDist)
-                minDist = dist;
+            for (int j = i + 1; j < body_count; ++j)
+            {
+                T dist = math.calcEuclideanDistance(bodies.x[i], bodies.y[i], bodies.x[j], bodies.y[j]);
+                if (dist < minDist)
+                    minDist = dist;
+            }
         }
     }
 
-    double scale = 0.8f + 0.8f * std::tanh(minDist * 0.8);
+    T scale = T(0.8) + T(0.8) * std::tanh(minDist * T(0.8));
+
+    T dampDt = dt * scale;
+
+    return std::max(dampDt, T(0.001));
+}
+
+// Rebuilds the neighbour grid from the current positions
+template <class T>
+void Gravity<T>::updateGrid()
+{
+    T minX = bodies.x[0], maxX = bodies.x[0];
+    T minY = bodies.y[0], maxY = bodies.y[0];
+
+    for (int i = 1; i < body_count; ++i)
+    {
+        minX = std::min(minX, bodies.x[i]);
+        maxX = std::max(maxX, bodies.x[i]);
+        minY = std::min(minY, bodies.y[i]);
+        maxY = std::max(maxY, bodies.y[i]);
+    }
 
-    double dampDt = dt * scale;
+    // Dense clusters get smaller cells so the cost follows the local density
+    T area = (maxX - minX) * (maxY - minY);
+    T cell = T(2) * std::sqrt(area / body_count);
+    cell = std::isfinite(cell) ? std::max(T(GridMinCellSize), std::min(T(GridMaxCellSize), cell)) : T(GridMaxCellSize);
 
-    return std::max(dampDt, 0.001);
+    grid.build(bodies.x, bodies.y, body_count, cell);
+    grid_valid = true;
 }
 
 // Minimal velocity calculation
-void Gravity::applyMinSpeed()
+template <class T>
+void Gravity<T>::applyMinSpeed()
 {
     for (int i = 0; i < body_count; ++i)
     {
-        Body &body = bodies[i];
-
         // Skip near center
-        double r = math->calcRadiusFromCenter(body.x, body.y);
+        T r = math.calcRadiusFromCenter(bodies.x[i], bodies.y[i]);
 
         if (r < 100.0 * 100.0)
         {
             continue;
         }
 
-        double v = math->calcSpeed(body.vx, body.vy);
-        double a = math->calcAcceleration(body.ax, body.ay);
+        T v = math.calcSpeed(bodies.vx[i], bodies.vy[i]);
+        T a = math.calcAcceleration(bodies.ax[i], bodies.ay[i]);
 
         if (v < vmin && a < 0.01f)
         {
             // Random angle in [0, 2π)
-            Vector v = math->randomImpulse(0.02, 0.07);
-            body.vx += v.x;
-            body.vy += v.y;
+            Vector<T> v = math.randomImpulse(0.02, 0.07);
+            bodies.vx[i] += v.x;
+            bodies.vy[i] += v.y;
         }
     }
 }
 
 // This helps prevent them from sticking together by applying a distance-based counter-force.
-void Gravity::applyCloseBodyRepulsion(int index, double vmin, double amin, double repel_zone, double repel_max)
+template <class T>
+void Gravity<T>::applyCloseBodyRepulsion(int index, T vmin, T amin, T repel_zone, T repel_max)
 {
     if (index < 0 || index >= body_count)
         return;
 
-    Body &body = bodies[index];
+    T bx = bodies.x[index];
+    T by = bodies.y[index];
 
     // Skip near center
-    double r = math->calcRadiusFromCenter(body.x, body.y);
+    T r = math.calcRadiusFromCenter(bx, by);
 
     if (r < 100.0 * 100.0)
     {
@@ -373,189 +1088,674 @@ void Gravity::applyCloseBodyRepulsion(int index, double vmin, double amin, doubl
     }
 
     // Check if body is stagnating
-    double v = math->calcSpeed(body.vx, body.vy);
-    double acc = math->calcAcceleration(body.ax, body.ay);
+    T v = math.calcSpeed(bodies.vx[index], bodies.vy[index]);
+    T acc = math.calcAcceleration(bodies.ax[index], bodies.ay[index]);
 
     bool isStagnating = (v < vmin && acc < amin);
     if (!isStagnating)
         return;
 
     // Strong random impulse to break deadlocks
-    double angle = ((double)rand() / RAND_MAX) * 2.0 * M_PI;
-    double impulse = 0.02 + ((double)rand() / RAND_MAX) * 0.05;
+    T angle = math.randomAngle();
+    T impulse = math.randomRange(0.02, 0.07);
 
-    body.vx += impulse * std::cos(angle);
-    body.vy += impulse * std::sin(angle);
+    bodies.vx[index] += impulse * std::cos(angle);
+    bodies.vy[index] += impulse * std::sin(angle);
 
-    // Repulsion from nearby bodies
-    for (int j = 0; j < body_count + 1; ++j)
+    // Repulsion from one nearby body
+    auto repel = [&](T nx, T ny)
     {
-        if (j == index)
-            continue;
-
-        Body &nbbody = (j < body_count) ? bodies[j] : blackHole;
-
-        if (j == body_count && blackHole.mass == 0)
-            continue;
-
-        Vector v = math->calcRelativePositionVector(nbbody.x, nbbody.y, body.x, body.y);
+        Vector<T> v = math.calcRelativePositionVector(nx, ny, bx, by);
 
         if (std::abs(v.x) > repel_zone || std::abs(v.y) > repel_zone)
-            continue;
+            return;
 
-        double dist_sqr = v.x * v.x + v.y * v.y;
+        T dist_sqr = v.x * v.x + v.y * v.y;
         if (dist_sqr >= repel_zone * repel_zone)
-            continue;
+            return;
 
-        double dist = std::sqrt(dist_sqr) + 1e-6;
-        double norm = 1.0 / dist;
+        T dist = std::sqrt(dist_sqr) + 1e-6;
+        T norm = 1.0 / dist;
 
-        double factor = (repel_zone - dist) / repel_zone;
-        double base_strength = repel_max * factor * factor;
+        T factor = (repel_zone - dist) / repel_zone;
+        T base_strength = repel_max * factor * factor;
 
         // Stronger jitter: ±100% of base strength
-        double jitter = ((double)rand() / RAND_MAX - 0.5) * base_strength * 2.0;
+        T jitter = (math.random() - 0.5) * base_strength * 2.0;
 
-        double fx = (base_strength + jitter) * v.x * norm;
-        double fy = (base_strength + jitter) * v.y * norm;
+        T fx = (base_strength + jitter) * v.x * norm;
+        T fy = (base_strength + jitter) * v.y * norm;
 
-        body.ax -= fx;
-        body.ay -= fy;
+        bodies.ax[index] -= fx;
+        bodies.ay[index] -= fy;
+    };
+
+    if (useGrid())
+    {
+        // Only bodies in the surrounding cells can be inside the repel zone
+        grid.forNeighbours(bx, by, [&](int j)
+                           {
+            if (j != index)
+                repel(bodies.x[j], bodies.y[j]); });
+    }
+    else
+    {
+        for (int j = 0; j < body_count; ++j)
+        {
+            if (j != index)
+                repel(bodies.x[j], bodies.y[j]);
+        }
     }
+
+    if (blackHole.mass != 0)
+        repel(blackHole.x, blackHole.y);
+}
+
+// Describes the current bodies for the force kernel
+template <class T>
+ForceField<T> Gravity<T>::forceField() const
+{
+    ForceField<T> field;
+    field.x = bodies.x;
+    field.y = bodies.y;
+    field.mass = bodies.mass;
+    field.count = body_count;
+    field.holeX = blackHole.x;
+    field.holeY = blackHole.y;
+    field.holeMass = blackHole.mass;
+    field.G = G;
+    field.softSqr = softening * softening;
+    return field;
 }
 
 // Computes the gravitational acceleration on the body at targetIndex
 // from all other bodies, including softening to avoid singularities.
-Vector Gravity::computeAcceleration(int targetIndex) const
+template <class T>
+Vector<T> Gravity<T>::computeAcceleration(int targetIndex) const
+{
+    Vector<T> v;
+    kernel->direct(forceField(), targetIndex, targetIndex + 1, &v.x, &v.y);
+    return v;
+}
+
+// Gravitational acceleration of all active bodies, written to bodies.ax/ay
+template <class T>
+void Gravity<T>::computeForces()
 {
-    const Body &target = bodies[targetIndex];
-    double ax = 0, ay = 0;
+    const ForceField<T> field = forceField();
+    force_evaluations += body_count;
 
-    for (int i = 0; i < body_count + 1; ++i)
+    switch (engine)
     {
-        // Skip self-interaction
-        if (i == targetIndex)
-            continue;
+    case ForceEngine::Symmetric:
+        computeSymmetricForces(field);
+        break;
+    case ForceEngine::Tree:
+    {
+        // The tree is built once and then only read by the workers
+        tree.build(field);
+
+        auto accelerate = [&](int begin, int end)
+        { tree.accelerate(field, begin, end, bodies.ax + begin, bodies.ay + begin); };
+        forBodies(accelerate);
+        break;
+    }
+    default:
+    {
+        auto direct = [&](int begin, int end)
+        { kernel->direct(field, begin, end, bodies.ax + begin, bodies.ay + begin); };
+        forBodies(direct);
+        break;
+    }
+    }
+}
 
-        const Body &other = (i < body_count) ? bodies[i] : blackHole;
+// Half-pairs engine. A pair updates both of its bodies, so every worker sums its rows into
+// its own buffer (worker 0 directly into bodies.ax/ay) and the buffers are added afterwards.
+template <class T>
+void Gravity<T>::computeSymmetricForces(const ForceField<T> &field)
+{
+    const int count = body_count;
+    const size_t stride = 2 * static_cast<size_t>(max_bodies);
 
-        if (i == body_count && blackHole.mass == 0)
-            continue;
+    auto rows = [&](int worker, int workers)
+    {
+        T *ax = worker == 0 ? bodies.ax : &scratch[(worker - 1) * stride];
+        T *ay = worker == 0 ? bodies.ay : ax + max_bodies;
 
-        // Compute relative position vector
-        Vector v = math->calcRelativePositionVector(target.x, target.y, other.x, other.y);
+        std::fill(ax, ax + count, 0.0);
+        std::fill(ay, ay + count, 0.0);
 
-        // Compute Euclidean distance between target and other
-        double distance = math->calcEuclideanDistance(v.x, v.y);
+        // Rows [r, count) hold about (count - r)^2 / 2 pairs, equal shares of that triangle keep the load even
+        auto rowStart = [&](int w)
+        { return count - static_cast<int>(std::lround(count * std::sqrt(1.0 - static_cast<double>(w) / workers))); };
 
-        // Apply softening to reduce numerical instability at short ranges
-        double currentSoftening = std::max(softening, distance * softening);
+        kernel->symmetric(field, rowStart(worker), rowStart(worker + 1), ax, ay);
+    };
+    forWorkers(rows);
 
-        // Compute softened squared distance for force calculation
-        double distSqr = v.x * v.x + v.y * v.y + currentSoftening * currentSoftening;
+    const int workers = parallelStep() ? pool.size() : 1;
 
-        if (distSqr <= 0.0 || distSqr < 0.0001)
+    auto reduce = [&](int begin, int end)
+    {
+        for (int w = 1; w < workers; ++w)
         {
-            continue;
+            const T *ax = &scratch[(w - 1) * stride];
+            const T *ay = ax + max_bodies;
+
+            for (int i = begin; i < end; ++i)
+            {
+                bodies.ax[i] += ax[i];
+                bodies.ay[i] += ay[i];
+            }
         }
 
-        // Compute inverse distance and its cube
-        double invDist = 1.0 / std::sqrt(distSqr);
-        double invDist3 = invDist * invDist * invDist;
+        for (int i = begin; i < end; ++i)
+        {
+            bodies.ax[i] *= field.G;
+            bodies.ay[i] *= field.G;
+        }
+    };
+    forBodies(reduce);
+}
 
-        // Accumulate gravitational acceleration components
-        ax += G * other.mass * v.x * invDist3;
-        ay += G * other.mass * v.y * invDist3;
-    }
+// computeForces() plus the position damping of the leapfrog step, the acceleration the integrators follow
+template <class T>
+void Gravity<T>::accelerate()
+{
+    computeForces();
 
-    // Return the total acceleration vector acting on the target body
-    Vector v;
-    v.x = ax;
-    v.y = ay;
-    return v;
+    auto damping = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            T pdamp = math.calcPositionDamping(bodies.x[i], bodies.y[i], pos_damping);
+            bodies.ax[i] -= bodies.x[i] * pdamp;
+            bodies.ay[i] -= bodies.y[i] * pdamp;
+        }
+    };
+    forBodies(damping);
 }
 
-// Implementation of the ThreeBodySystem methods
-// Performs one simulation step using the Leapfrog integration method.
-// Updates positions, calculates new accelerations, and updates velocities with damping.
-void Gravity::simulate()
+// accelerate() of a single body against the current positions of all others
+template <class T>
+void Gravity<T>::accelerateBody(int index)
 {
-    double currentDt = computeAdaptiveDt();
+    initBody(index);
+    force_evaluations++;
+}
 
-    for (int i = 0; i < body_count; ++i)
+// Moves the bodies over h with a higher order integrator and leaves the accelerations at the new positions
+template <class T>
+void Gravity<T>::integrate(Integrator scheme, T h)
+{
+    switch (scheme)
     {
-        Body &body = bodies[i];
-        body.x += body.vx * currentDt + 0.5 * body.ax * currentDt * currentDt;
-        body.y += body.vy * currentDt + 0.5 * body.ay * currentDt * currentDt;
+    case Integrator::Yoshida4:
+        stepYoshida4(h);
+        break;
+    case Integrator::RK45:
+        stepRK45(h);
+        break;
+    case Integrator::Block:
+        stepBlock(h);
+        break;
+    default:
+        break;
     }
+}
 
-    // Store current accelerations to be used in velocity update
-    double oldAx[body_count], oldAy[body_count];
-    for (int i = 0; i < body_count; ++i)
+// Yoshida's fourth-order composition: three kick-drift-kick leapfrog steps of w1, w0, w1 times h.
+// w0 is negative, the middle step runs backwards. Symplectic like leapfrog, three force evaluations.
+template <class T>
+void Gravity<T>::stepYoshida4(T h)
+{
+    const T w1 = T(1) / (T(2) - std::cbrt(T(2)));
+    const T w0 = T(1) - T(2) * w1;
+
+    T k = 0; // Kick and drift factors of the running substep
+    T d = 0;
+
+    auto kick = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            bodies.vx[i] += bodies.ax[i] * k;
+            bodies.vy[i] += bodies.ay[i] * k;
+        }
+    };
+
+    auto drift = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            bodies.x[i] += bodies.vx[i] * d;
+            bodies.y[i] += bodies.vy[i] * d;
+        }
+    };
+
+    const T kicks[4] = {T(0.5) * w1 * h, T(0.5) * (w0 + w1) * h, T(0.5) * (w0 + w1) * h, T(0.5) * w1 * h};
+    const T drifts[3] = {w1 * h, w0 * h, w1 * h};
+
+    for (int s = 0; s < 3; ++s)
     {
-        oldAx[i] = bodies[i].ax;
-        oldAy[i] = bodies[i].ay;
+        k = kicks[s];
+        forBodies(kick);
+        d = drifts[s];
+        forBodies(drift);
+        accelerate();
     }
 
-    for (int i = 0; i < body_count; ++i)
+    k = kicks[3];
+    forBodies(kick);
+}
+
+// Dormand–Prince 5(4) coefficients. The last stage is evaluated at the fifth-order solution,
+// so it is the first stage of the next substep (first same as last).
+static const double DpC[7] = {0.0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1.0, 1.0};
+static const double DpA[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0 / 5, 0, 0, 0, 0, 0},
+    {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+    {44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0},
+    {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0},
+    {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0},
+    {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84}};
+// Difference of the fifth- and fourth-order weights, the local error estimate
+static const double DpE[7] = {71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40};
+
+// Error controlled Dormand–Prince substeps until h is covered. The substep grows and shrinks with
+// the error estimate and starts from the last accepted one, so quiet orbits take a single substep
+// per step and close encounters are resolved without lowering dt.
+template <class T>
+void Gravity<T>::stepRK45(T h)
+{
+    const int n = body_count;
+    const size_t stride = static_cast<size_t>(max_bodies);
+
+    // Start state, then the x, y, vx, vy derivatives of the seven stages
+    if (rk.empty())
+        rk.assign(32 * stride, T(0));
+
+    T *x0 = &rk[0];
+    T *y0 = &rk[stride];
+    T *vx0 = &rk[2 * stride];
+    T *vy0 = &rk[3 * stride];
+    auto stage = [&](int s, int c) { return &rk[(4 + 4 * s + c) * stride]; };
+
+    std::copy(bodies.x, bodies.x + n, x0);
+    std::copy(bodies.y, bodies.y + n, y0);
+    std::copy(bodies.vx, bodies.vx + n, vx0);
+    std::copy(bodies.vy, bodies.vy + n, vy0);
+
+    // The accelerations of the last step are the first stage
+    std::copy(bodies.vx, bodies.vx + n, stage(0, 0));
+    std::copy(bodies.vy, bodies.vy + n, stage(0, 1));
+    std::copy(bodies.ax, bodies.ax + n, stage(0, 2));
+    std::copy(bodies.ay, bodies.ay + n, stage(0, 3));
+
+    const T minStep = h * T(1e-6);
+    T done = 0;
+    T sub = rk_step > 0 ? std::min(rk_step, h) : h;
+    T err = 0;
+    int s = 0;
+
+    // State at stage s: start state plus the weighted stage derivatives, then its derivative
+    auto combine = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            T sx = 0, sy = 0, svx = 0, svy = 0;
+
+            for (int j = 0; j < s; ++j)
+            {
+                const T a = static_cast<T>(DpA[s][j]);
+                sx += a * stage(j, 0)[i];
+                sy += a * stage(j, 1)[i];
+                svx += a * stage(j, 2)[i];
+                svy += a * stage(j, 3)[i];
+            }
+
+            bodies.x[i] = x0[i] + sub * sx;
+            bodies.y[i] = y0[i] + sub * sy;
+            bodies.vx[i] = vx0[i] + sub * svx;
+            bodies.vy[i] = vy0[i] + sub * svy;
+        }
+    };
+
+    auto derivative = [&](int begin, int end)
+    {
+        std::copy(bodies.vx + begin, bodies.vx + end, stage(s, 0) + begin);
+        std::copy(bodies.vy + begin, bodies.vy + end, stage(s, 1) + begin);
+        std::copy(bodies.ax + begin, bodies.ax + end, stage(s, 2) + begin);
+        std::copy(bodies.ay + begin, bodies.ay + end, stage(s, 3) + begin);
+    };
+
+    // Largest error of all values relative to the tolerance, 1 is just acceptable
+    auto estimate = [&]()
     {
-        Body &body = bodies[i];
+        T worst = 0;
+
+        for (int c = 0; c < 4; ++c)
+        {
+            const T *start = &rk[c * stride];
+            const T *end = c == 0 ? bodies.x : c == 1 ? bodies.y : c == 2 ? bodies.vx : bodies.vy;
 
-        // Compute new acceleration including gravitational and position damping
-        Vector v = computeAcceleration(i);
+            for (int i = 0; i < n; ++i)
+            {
+                T e = 0;
+                for (int j = 0; j < 7; ++j)
+                    e += static_cast<T>(DpE[j]) * stage(j, c)[i];
 
-        // Damping increases with distance to prevent runaway trajectories
-        double pdamp = math->calcPositionDamping(body.x, body.y, pos_damping);
-        body.ax = v.x - body.x * pdamp;
-        body.ay = v.y - body.y * pdamp;
+                T scale = tolerance * (T(1) + std::max(std::abs(start[i]), std::abs(end[i])));
+                worst = std::max(worst, std::abs(sub * e) / scale);
+            }
+        }
 
-        applyCloseBodyRepulsion(i, 0.02, 0.001, 1.0, 0.1);
+        return std::isfinite(worst) ? worst : T(1e10);
+    };
+
+    for (int attempt = 0; done < h; ++attempt)
+    {
+        const bool last = done + sub >= h;
+        if (last)
+            sub = h - done;
+
+        for (s = 1; s < 7; ++s)
+        {
+            forBodies(combine);
+            accelerate();
+            forBodies(derivative);
+        }
+
+        err = estimate();
+        T grow = err > 0 ? std::max(T(0.2), std::min(T(5), T(0.9) * std::pow(err, T(-0.2)))) : T(5);
+
+        // Accepted, the bodies hold the fifth-order solution and the last stage becomes the first
+        if (err <= 1 || sub <= minStep || attempt >= MaxRK45Substeps)
+        {
+            done = last ? h : done + sub;
+
+            std::copy(bodies.x, bodies.x + n, x0);
+            std::copy(bodies.y, bodies.y + n, y0);
+            std::copy(bodies.vx, bodies.vx + n, vx0);
+            std::copy(bodies.vy, bodies.vy + n, vy0);
+
+            for (int c = 0; c < 4; ++c)
+                std::copy(stage(6, c), stage(6, c) + n, stage(0, c));
+
+            // A substep cut short by the end of the step says nothing about the next one
+            if (!last || grow < 1)
+                rk_step = sub * grow;
+        }
+
+        sub = std::max(sub * grow, minStep);
     }
+}
 
-    // new positions
-    for (int i = 0; i < body_count; ++i)
+// Block timestep leapfrog. Every body gets a substep of h / 2^level from its free-fall time to the
+// nearest body, all bodies drift at the finest substep and only the bodies whose substep ends are
+// kicked with a new acceleration. Levels are fixed for the duration of one step.
+template <class T>
+void Gravity<T>::stepBlock(T h)
+{
+    const int n = body_count;
+
+    if (level.empty())
+        level.assign(max_bodies, 0);
+
+    int top = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        const T xi = bodies.x[i];
+        const T yi = bodies.y[i];
+
+        // Nearest body and black hole, weighted by the mass pulling them together
+        T worst = 0;
+
+        auto check = [&](T x, T y, T m)
+        {
+            T d2 = (x - xi) * (x - xi) + (y - yi) * (y - yi) + softening * softening;
+            T d3 = d2 * std::sqrt(d2);
+            if (d3 > 0)
+                worst = std::max(worst, G * (bodies.mass[i] + m) / d3);
+        };
+
+        if (useGrid())
+        {
+            grid.forNeighbours(xi, yi, [&](int j)
+                               {
+                if (j != i)
+                    check(bodies.x[j], bodies.y[j], bodies.mass[j]); });
+        }
+        else
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                if (j != i)
+                    check(bodies.x[j], bodies.y[j], bodies.mass[j]);
+            }
+        }
+
+        if (blackHole.mass != 0)
+            check(blackHole.x, blackHole.y, blackHole.mass);
+
+        // Free-fall time 1 / sqrt(G m / d^3), the level halves h until the substep is below a fraction of it
+        int l = 0;
+        if (worst > 0)
+        {
+            T tau = T(BlockAccuracy) / std::sqrt(worst);
+            while (l < MaxBlockLevel && (h / T(1 << l)) > tau)
+                ++l;
+        }
+
+        level[i] = l;
+        top = std::max(top, l);
+    }
+
+    const int substeps = 1 << top;
+    const T fine = h / T(substeps);
+
+    auto drift = [&](int begin, int end)
     {
-        Body &body = bodies[i];
+        for (int i = begin; i < end; ++i)
+        {
+            bodies.x[i] += bodies.vx[i] * fine;
+            bodies.y[i] += bodies.vy[i] * fine;
+        }
+    };
+
+    // Half kick of every body whose own substep starts (opening) or ends (closing) at fine substep s
+    auto kick = [&](int s)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const int span = 1 << (top - level[i]);
+
+            if (s % span == 0)
+            {
+                T half = T(0.5) * fine * T(span);
+                bodies.vx[i] += bodies.ax[i] * half;
+                bodies.vy[i] += bodies.ay[i] * half;
+            }
+        }
+    };
 
-        // Velocity update using averaged acceleration (Leapfrog step 2)
-        body.vx += 0.5 * (oldAx[i] + body.ax) * currentDt;
-        body.vy += 0.5 * (oldAy[i] + body.ay) * currentDt;
+    for (int s = 0; s < substeps; ++s)
+    {
+        kick(s);
+        forBodies(drift);
 
-        if (nudge_mode)
+        // All bodies end together at the end of the step, one pass of the force engine serves them
+        if (s + 1 == substeps)
+            accelerate();
+        else
         {
-            if (nudge_step == 20)
+            for (int i = 0; i < n; ++i)
             {
-                nudge_mode = false;
-                nudge_step = 0;
+                if ((s + 1) % (1 << (top - level[i])) == 0)
+                    accelerateBody(i);
             }
+        }
+
+        kick(s + 1);
+    }
+}
+
+// Implementation of the ThreeBodySystem methods
+// Performs one simulation step using the Leapfrog integration method, or the selected integrator.
+// Updates positions, calculates new accelerations, and updates velocities with damping.
+template <class T>
+void Gravity<T>::simulate()
+{
+    applyChanges();
+    applyThreadCount();
+
+    PhaseClock clock(profiling);
+
+    // The grid of the previous step still matches the positions unless they were set from outside
+    if (useGrid() && !grid_valid)
+        updateGrid();
 
-            double nudge_factor = 10 * (5.0 + pos_damping);
-            Vector v = math->randomImpulse(-nudge_factor / 2, nudge_factor / 2);
-            body.vx = v.x;
-            body.vy = v.y;
+    clock.lap(profile.grid);
 
-            nudge_step++;
+    T currentDt = computeAdaptiveDt();
+    const Integrator scheme = integrator;
+    const bool leapfrog = scheme == Integrator::Leapfrog;
+
+    clock.lap(profile.adaptiveDt);
+
+    auto positions = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            // Store current accelerations to be used in velocity update
+            oldAx[i] = bodies.ax[i];
+            oldAy[i] = bodies.ay[i];
+
+            bodies.x[i] += bodies.vx[i] * currentDt + T(0.5) * bodies.ax[i] * currentDt * currentDt;
+            bodies.y[i] += bodies.vy[i] * currentDt + T(0.5) * bodies.ay[i] * currentDt * currentDt;
         }
+    };
+    if (leapfrog)
+        forBodies(positions);
+
+    clock.lap(profile.position);
+
+    // The other integrators move the bodies and evaluate the forces in one go
+    if (!leapfrog)
+    {
+        integrate(scheme, currentDt);
+        clock.lap(profile.force);
+    }
+
+    // One grid build per step serves the repulsion now and the adaptive dt of the next step
+    if (useGrid())
+        updateGrid();
+
+    clock.lap(profile.grid);
+
+    // Crossings of this step against the new positions, sim_time is still the time at its start
+    events.detect(bodies, body_count, blackHole, useGrid() ? &grid : nullptr, sim_time, currentDt, eventQueue);
+
+    clock.lap(profile.events);
+
+    // Gravitational acceleration of all bodies in one pass
+    if (leapfrog)
+        computeForces();
 
-        // Compute velocity magnitude for dynamic velocity damping
-        double speed = math->calcSpeed(body.vx, body.vy);
+    clock.lap(profile.force);
 
-        // Velocity damping increases with speed to limit energy escalation
-        double vdamp = vel_damping * (1.0 + speed);
-        body.vx *= 1.0 - vdamp;
-        body.vy *= 1.0 - vdamp;
+    for (int i = 0; i < body_count; ++i)
+    {
+        // Damping increases with distance to prevent runaway trajectories, accelerate() applied it already
+        if (leapfrog)
+        {
+            T pdamp = math.calcPositionDamping(bodies.x[i], bodies.y[i], pos_damping);
+            bodies.ax[i] -= bodies.x[i] * pdamp;
+            bodies.ay[i] -= bodies.y[i] * pdamp;
+        }
 
-        // Clamp velocity to minimum and maximum thresholds
-        Vector v = math->clampSpeed(body.vx, body.vy, vmin, vmax);
-        body.vx = v.x;
-        body.vy = v.y;
+        applyCloseBodyRepulsion(i, 0.02, 0.001, 1.0, 0.1);
     }
 
+    clock.lap(profile.repulsion);
+
+    // Nudging draws random numbers in body order, so that step stays on this thread
+    const bool nudging = nudge_mode;
+
+    // new velocities
+    auto velocities = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            T &vx = bodies.vx[i];
+            T &vy = bodies.vy[i];
+
+            // Velocity update using averaged acceleration (Leapfrog step 2)
+            if (leapfrog)
+            {
+                vx += T(0.5) * (oldAx[i] + bodies.ax[i]) * currentDt;
+                vy += T(0.5) * (oldAy[i] + bodies.ay[i]) * currentDt;
+            }
+
+            if (nudging && nudge_mode)
+            {
+                if (nudge_step == 20)
+                {
+                    nudge_mode = false;
+                    nudge_step = 0;
+                }
+
+                T nudge_factor = 10 * (5.0 + pos_damping);
+                Vector<T> v = math.randomImpulse(-nudge_factor / 2, nudge_factor / 2);
+                vx = v.x;
+                vy = v.y;
+
+                nudge_step++;
+            }
+
+            // Compute velocity magnitude for dynamic velocity damping
+            T speed = math.calcSpeed(vx, vy);
+
+            // Velocity damping increases with speed to limit energy escalation
+            T vdamp = vel_damping * (T(1) + speed);
+            vx *= T(1) - vdamp;
+            vy *= T(1) - vdamp;
+
+            // Clamp velocity to minimum and maximum thresholds
+            Vector<T> v = math.clampSpeed(vx, vy, vmin, vmax);
+            vx = v.x;
+            vy = v.y;
+        }
+    };
+
+    if (nudging)
+        velocities(0, body_count);
+    else
+        forBodies(velocities);
+
     applyMinSpeed();
+
+    clock.lap(profile.velocity);
+
+    if (profiling)
+        profile.steps++;
+
+    step_count++;
+    sim_time += currentDt;
 }
 
 // Loads one of ten predefined body configurations and sets active body count.
-void Gravity::loadPreset(int presetIndex)
+template <class T>
+void Gravity<T>::loadPreset(int presetIndex)
+{
+    change(ParamChange{Param::Preset, presetIndex, {}, nullptr});
+}
+
+template <class T>
+void Gravity<T>::applyPreset(int presetIndex)
 {
     // Clamp preset index to valid range
     int p = presetIndex < 1 ? 1 : (presetIndex > 14 ? 14 : presetIndex);
@@ -668,15 +1868,15 @@ void Gravity::loadPreset(int presetIndex)
         setSoftening(0.4);
         setPosDamping(0.02);
         setVelDamping(0.01);
-        setBodyCount(BodyCount);
+        setBodyCount(PresetBodyCount);
 
-        for (int i = 0; i < BodyCount; ++i)
+        for (int i = 0; i < PresetBodyCount; ++i)
         {
-            double x = (rand() % 200) - 100;
-            double y = (rand() % 200) - 100;
-            double vx = ((rand() % 200) - 100) * 0.005;
-            double vy = ((rand() % 200) - 100) * 0.005;
-            setBody(i, x, y, vx, vy, 0.5f + (rand() % 100) * 0.01);
+            double x = math.randomInt(200) - 100;
+            double y = math.randomInt(200) - 100;
+            double vx = (math.randomInt(200) - 100) * 0.005;
+            double vy = (math.randomInt(200) - 100) * 0.005;
+            setBody(i, x, y, vx, vy, 0.5f + math.randomInt(100) * 0.01);
         }
         break;
     case 6:
@@ -711,7 +1911,7 @@ void Gravity::loadPreset(int presetIndex)
         setBody(0, 0, 0, 0.347111, 0.532728, 1);
         setBody(1, 0.970004, -0.243087, -0.347111, 0.532728, 1);
         setBody(2, -0.970004, 0.243087, 0, -1.065456, 1);
-        for (int i = 3; i < BodyCount; ++i)
+        for (int i = 3; i < PresetBodyCount; ++i)
         {
             setBody(i, 0, 0, 0, 0, 0);
         }
@@ -723,9 +1923,9 @@ void Gravity::loadPreset(int presetIndex)
         setSoftening(0.2);
         setPosDamping(0.02);
         setVelDamping(0.005);
-        setBodyCount(BodyCount);
+        setBodyCount(PresetBodyCount);
 
-        for (int i = 0; i < BodyCount; ++i)
+        for (int i = 0; i < PresetBodyCount; ++i)
         {
             double x = i * 50.0;
             double y = 0;
@@ -742,9 +1942,9 @@ void Gravity::loadPreset(int presetIndex)
         setSoftening(0);
         setPosDamping(0.02);
         setVelDamping(0.01);
-        setBodyCount(BodyCount);
+        setBodyCount(PresetBodyCount);
 
-        for (int i = 0; i < BodyCount; ++i)
+        for (int i = 0; i < PresetBodyCount; ++i)
         {
             double angle = 2 * M_PI * i / 10.0;
             double vx = std::cos(angle) * 0.3;
@@ -818,3 +2018,6 @@ void Gravity::loadPreset(int presetIndex)
         break;
     }
 }
+
+template class Gravity<float>;
+template class Gravity<double>;
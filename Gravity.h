@@ -1,5 +1,6 @@
 // Gravity.h – Simulation core for N-body gravitational interaction
-// This header defines the Body struct and the Gravity class which implements the physics simulation
+// This header defines the Gravity class which implements the physics simulation.
+// The core is a template on its scalar type and is built for float and double.
 
 #ifndef GRAVITY_H
 #define GRAVITY_H
@@ -9,24 +10,68 @@
 #include <cmath>
 #include <algorithm>
 #include <vector>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
 #include "GravityMath.h"
+#include "BodyStore.h"
+#include "GravityState.h"
+#include "ForceKernel.h"
+#include "BarnesHut.h"
+#include "SpatialGrid.h"
+#include "EventDetector.h"
+#include "EventQueue.h"
+#include "ParamQueue.h"
+#include "WorkerPool.h"
 
-// Represents a single body in 2D space
-struct Body
+// Strategies for evaluating the gravitational forces
+enum class ForceEngine
 {
-    double x, y;   // Position
-    double vx, vy; // Velocity
-    double ax, ay; // Acceleration
-    double mass;   // Mass
+    Direct,    // Every body sums the pull of all others
+    Symmetric, // Every pair once with equal and opposite contributions (Newton's third law)
+    Tree,      // Barnes–Hut quadtree, distant groups approximated by their center of mass
 };
 
-// Encapsulates the physics simulation for up to 10 bodies
+// Time integration schemes of simulate()
+enum class Integrator
+{
+    Leapfrog, // Velocity Verlet, one force evaluation per step (default)
+    Yoshida4, // Fourth-order symplectic composition of three leapfrog steps, three evaluations per step
+    RK45,     // Dormand–Prince 5(4) with error control, substeps until the tolerance is met
+    Block,    // Leapfrog with power-of-two substeps per body, only bodies in close encounters substep
+};
+
+// Time spent in the phases of simulate() while profiling is enabled
+struct StepProfile
+{
+    uint64_t steps;      // Profiled steps
+    uint64_t adaptiveDt; // Nanoseconds in the adaptive timestep search
+    uint64_t position;   // Nanoseconds in the position update
+    uint64_t grid;       // Nanoseconds rebuilding the neighbour grid
+    uint64_t force;      // Nanoseconds in the force engine
+    uint64_t repulsion;  // Nanoseconds in position damping and close body repulsion
+    uint64_t velocity;   // Nanoseconds in the velocity update and minimum speed
+    uint64_t events;     // Nanoseconds detecting encounters and black hole approaches
+};
+
+// Encapsulates the physics simulation for a configurable number of bodies
+template <class T>
 class Gravity
 {
 public:
-    Gravity();  // Constructor 
-    ~Gravity(); // Destructor
-    static const int BodyCount = 10; // Number of bodies in the system
+    Gravity(int maxBodies = DefaultMaxBodies); // Constructor, maxBodies is fixed for the lifetime of the system
+    ~Gravity();                                // Destructor
+    static const int DefaultMaxBodies = 10;    // Default body capacity
+    static const int MaxBodyLimit = 16384;     // Upper bound for the body capacity
+    static const int PresetBodyCount = 10;     // Number of bodies used by the presets
+    static const int GridThreshold = 64;       // Above this body count neighbour searches use the spatial grid
+    static constexpr double GridMaxCellSize = 8.0; // Largest grid cell, also the cap for the adaptive dt distance
+    static constexpr double GridMinCellSize = 1.0; // Smallest grid cell, has to cover the repel zone
+    static const int ParallelThreshold = 256;  // From this body count on a step is split across the worker threads
+    static constexpr double DefaultTolerance = 1e-6; // Error per step of the RK45 integrator
+    static const int MaxBlockLevel = 8;              // Block integrator: at most 2^8 substeps per step
+    static constexpr double BlockAccuracy = 0.05;    // Block integrator: substep as a fraction of the free-fall time to the nearest body
+    static const int MaxRK45Substeps = 1000;         // RK45: substeps per step before the error control gives up
 
     void loadPreset(int presetIndex); // Load a predefined body configuration (0–13)
 
@@ -37,58 +82,188 @@ public:
     void setSoftening(double s);                        // Set base softening value to prevent singularities
     void setVmin(double v);                             // Set the minimum velocity
     void setVmax(double v);                             // Set the maximum velocity
-    void setBodyCount(int count);                       // Set how many bodies are active (2–10)
+    void setBodyCount(int count);                       // Set how many bodies are active (2–max bodies)
     void setBodyMass(int index, double mass);           // Sets a bodies mass at simulation time
     void setBlackHole(double x, double y, double mass); // Sets position and mass for the black hole
+    bool setSimd(const char *name);                     // Selects the force kernel (auto, scalar, avx2, avx512, neon)
+    bool setEngine(const char *name);                   // Selects the force engine (direct, symmetric, tree)
+    bool setIntegrator(const char *name);               // Selects the integrator (leapfrog, yoshida4, rk45, block)
+    void setTolerance(double tolerance);                // Set the error per step of the RK45 integrator
+    void setTheta(double theta);                        // Set the Barnes–Hut opening angle
+    void setThreads(int count);                         // Set the threads per step, applied before the next step
+    void setSeed(int seed);                             // Seed the random generator of this instance
+    void setProfiling(bool on);                         // Times the phases of every step, resets the profile
+    void setEncounterRadius(double r);                  // Pair distance that triggers encounter events, 0 off
+    void setHoleRadius(double r);                       // Black hole distance that triggers hole events, 0 off
 
     void nudge(); // Nudges the Bodies when they got stuck
 
-    double getG() const { return G; }                    // Get gravitational constant
-    double getDt() const { return dt; }                  // Get simulation time step
-    double getVmin() const { return vmin; }              // Gets the minimum velocity
-    double getVmax() const { return vmax; }              // Gets the maximumn velocity
-    double getPosDamping() const { return pos_damping; } // Get position damping coefficient
-    double getVelDamping() const { return vel_damping; } // Get velocity damping coefficient
-    double getSoftening() const { return softening; }    // Get base softening value
+    T getG() const { return G; }                         // Get gravitational constant
+    T getDt() const { return dt; }                       // Get simulation time step
+    T getVmin() const { return vmin; }                   // Gets the minimum velocity
+    T getVmax() const { return vmax; }                   // Gets the maximumn velocity
+    T getPosDamping() const { return pos_damping; }      // Get position damping coefficient
+    T getVelDamping() const { return vel_damping; }      // Get velocity damping coefficient
+    T getSoftening() const { return softening; }         // Get base softening value
     int getBodyCount() const { return body_count; }      // Get current number of active bodies
+    int getMaxBodies() const { return max_bodies; }      // Get the body capacity set at creation time
+    const char *getSimd() const { return kernel->name; } // Get the name of the active force kernel
+    const char *getEngine() const;                       // Get the name of the active force engine
+    const char *getIntegrator() const;                   // Get the name of the active integrator
+    double getTolerance() const { return tolerance; }    // Get the error per step of the RK45 integrator
+    double getTheta() const { return tree.getTheta(); }  // Get the Barnes–Hut opening angle
+    int getThreads() const { return requested_threads; } // Get the threads per step
+    int getSeed() const { return static_cast<int>(math.getSeed()); } // Get the seed of the random generator
 
-    const Body &getBlackHole() const;         // Gets the black hole
-    const Body &getBody(int index) const;     // Get body by index (current state)
-    std::vector<Body> getBodies() const;      // Returns a copy of all current body states for thread safety
-    const Body &getInitBody(int index) const; // Get initial body state by index
+    const Body<T> &getBlackHole() const;      // Gets the black hole
+    Body<T> getBody(int index) const;         // Get body by index (current state)
+    std::vector<Body<T>> getBodies() const;   // Returns a copy of all active body states for thread safety
+    int copyBodies(Body<T> *out) const;       // Copies the active bodies to out without allocating, returns the count
+    uint64_t getStep() const { return step_count; } // Simulation steps done since creation
+    uint64_t getForceEvaluations() const { return force_evaluations; } // Body accelerations evaluated since creation
+    double getTime() const { return sim_time; }     // Simulated time since creation (sum of the adaptive dt)
+    const StepProfile &getProfile() const { return profile; } // Phase times since profiling was enabled
+    double getEncounterRadius() const { return events.getEncounterRadius(); } // Pair distance of encounter events
+    double getHoleRadius() const { return events.getHoleRadius(); }           // Black hole distance of hole events
+    EventQueue &getEvents() { return eventQueue; }                          // Events of the steps, drained by the output
+    Body<T> getInitBody(int index) const;     // Get initial body state by index
 
     void setBody(int index, double x, double y, double vx, double vy, double mass); // Set initial values for a body
 
+    size_t getStateSize() const;                   // Bytes saveState() writes for the active bodies
+    size_t saveState(void *out, size_t size) const; // Writes the complete state (GravityState.h), 0 if size is too small
+    bool loadState(const void *data, size_t size);  // Restores a saved state, false if it is invalid or too large
+
     void reset();    // Reset all bodies to initial state and reinitialize
     void simulate(); // Perform one simulation step
 
+    // While deferred, every setter above validates on the calling thread and queues the change,
+    // simulate() applies the queued changes before the step. Turning it off applies what is pending.
+    void setDeferred(bool on);
+    void applyChanges(); // Applies the queued changes, on the thread that steps the system
+    uint64_t getChangesDropped() const { return changes.getDropped(); } // Changes lost to a full queue
+
 private:
-    GravityMath *math;                 // Physics calculations
+    GravityMath<T> math;               // Physics calculations, inlined into the loops
     void initParams();                 // Initialize default simulation parameters
     void resetBodies();                // Resets every body value to 0
     void initBody(int index);          // Initialize a single body’s acceleration
-    double computeAdaptiveDt() const;  // Adaptive timestep depending on proximity
+    void change(const ParamChange &c); // Applies a validated change now or queues it while deferred
+    void applyChange(const ParamChange &c);                // Applies one change
+    void applyBody(int index, const T *values);            // setBody() with the pull on the other bodies
+    void applyBodyCount(int count);                        // setBodyCount() with the pull of added or removed bodies
+    void addPull(T x, T y, T mass, int skip, int begin, int end); // Adds the pull of a point mass to [begin, end)
+    void applyPreset(int presetIndex);                     // The preset switch of loadPreset()
+    void applyReset();                                     // The body reset of reset()
+    bool checkState(const void *data, size_t size) const;  // Validates a state of saveState()
+    void restoreState(const void *data);                   // Restores a validated state
+    T computeAdaptiveDt() const;       // Adaptive timestep depending on proximity
     void applyMinSpeed();              // Minimal velocity calculation
+    void updateGrid();                 // Rebuilds the neighbour grid from the current positions
+    bool useGrid() const { return body_count > GridThreshold; }
 
     // This helps prevent them from sticking together by applying a distance-based counter-force.
-    void applyCloseBodyRepulsion(int index, double vmin, double amin, double repel_zone, double repel_max);
+    void applyCloseBodyRepulsion(int index, T vmin, T amin, T repel_zone, T repel_max);
+
+    Vector<T> computeAcceleration(int targetIndex) const; // Calculate acceleration on one body
+    ForceField<T> forceField() const;                     // Describes the current bodies for the force kernel
+    void computeForces();                                 // Gravitational acceleration of all active bodies
+    void accelerate();                                    // computeForces() plus position damping
+    void accelerateBody(int index);                       // accelerate() of one body, direct sum
+    void integrate(Integrator scheme, T h);               // One step of a higher order integrator
+    void stepYoshida4(T h);                               // Fourth-order symplectic step
+    void stepRK45(T h);                                   // Error controlled Dormand–Prince substeps
+    void stepBlock(T h);                                  // Block timestep leapfrog
+    void computeSymmetricForces(const ForceField<T> &f);  // Half-pairs engine, one accumulation buffer per worker
+    void applyThreadCount();                              // Resizes the worker pool to the requested thread count
+    bool parallelStep() const { return pool.size() > 1 && body_count >= ParallelThreshold; }
+
+    // Adds the time since the previous lap to one phase of the profile, does nothing unless profiling
+    class PhaseClock
+    {
+    public:
+        explicit PhaseClock(bool on) : enabled(on)
+        {
+            if (enabled)
+                last = std::chrono::steady_clock::now();
+        }
+
+        void lap(uint64_t &phase)
+        {
+            if (!enabled)
+                return;
+
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            phase += std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+            last = now;
+        }
+
+    private:
+        bool enabled;
+        std::chrono::steady_clock::time_point last;
+    };
+
+    // Calls f(begin, end) for the active bodies, split across the workers when the step runs in parallel
+    template <class F>
+    void forBodies(F &f)
+    {
+        if (parallelStep())
+            pool.parallelFor(body_count, f);
+        else
+            f(0, body_count);
+    }
 
-    Vector computeAcceleration(int targetIndex) const; // Calculate acceleration on one body
+    // Calls f(worker, workers) on every worker when the step runs in parallel, f(0, 1) otherwise
+    template <class F>
+    void forWorkers(F &f)
+    {
+        if (parallelStep())
+            pool.forEachWorker(f);
+        else
+            f(0, 1);
+    }
 
-    Body initBodies[BodyCount]; // Array holding initial body states
-    Body bodies[BodyCount];     // Array holding current body states
-    Body blackHole;             // The black hole
+    BodyStore<T> initBodies;      // Initial body states
+    BodyStore<T> bodies;          // Current body states
+    Body<T> blackHole;            // The black hole
+    std::vector<T> oldAx;         // Accelerations x of the previous step
+    std::vector<T> oldAy;         // Accelerations y of the previous step
+    const ForceKernel<T> *kernel; // Pairwise force kernel, selected at runtime
+    ForceEngine engine;           // Force evaluation strategy
+    BarnesHut<T> tree;            // Quadtree for the tree engine
+    SpatialGrid<T> grid;          // Neighbour grid for repulsion and adaptive dt
+    bool grid_valid;              // False when positions changed since the last grid build
+    WorkerPool pool;              // Helper threads for the position, force and velocity phases
+    EventDetector<T> events;      // Encounter and black hole events of every step
+    EventQueue eventQueue;        // Detected events for the output
+    std::vector<T> scratch;             // Per-worker accumulation buffers of the symmetric engine
+    Integrator integrator;              // Time integration scheme
+    T tolerance;                        // Error per step of RK45
+    T rk_step;                          // Last accepted RK45 substep, the first guess of the next step
+    std::vector<T> rk;                  // RK45 start state and stages, 32 arrays of max_bodies
+    std::vector<int> level;             // Block level per body, substep h / 2^level
+    uint64_t force_evaluations;         // Body accelerations evaluated since creation
+    ParamQueue changes;                 // Changes of the setters while deferred
+    ParamMailbox incomingState;         // State of loadState() while deferred
+    uint64_t state_serial;              // States handed to incomingState, counted by the setting thread
+    std::atomic<bool> deferred;         // Setters queue their changes
+    std::atomic<int> requested_threads; // Thread count set by the threads message
 
-    double G;           // Gravitational constant
-    double dt;          // Timestep
-    double pos_damping; // Damping based on distance from origin
-    double vel_damping; // Damping based on body speed
-    double softening;   // Base value to prevent singularities
-    double vmin;        // Minimum vewlociy
-    double vmax;        // Maximum velocity
+    T G;                // Gravitational constant
+    T dt;               // Timestep
+    T pos_damping;      // Damping based on distance from origin
+    T vel_damping;      // Damping based on body speed
+    T softening;        // Base value to prevent singularities
+    T vmin;             // Minimum vewlociy
+    T vmax;             // Maximum velocity
     int body_count;     // Number of active bodies
+    int max_bodies;     // Body capacity
     bool nudge_mode;    // nudge indicator for simulation
     int nudge_step;     // Current simulation step in nudging mode
+    uint64_t step_count; // Simulation steps done since creation
+    double sim_time;     // Simulated time since creation
+    bool profiling;      // Phase timing enabled
+    StepProfile profile; // Phase times while profiling
 };
 
 #endif // GRAVITY_H
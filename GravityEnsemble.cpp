@@ -0,0 +1,388 @@
+// GravityEnsemble.cpp – Many variations of one system stepped in lockstep
+// The lane loops are marked for SIMD (-fopenmp-simd), -fno-math-errno lets sqrt vectorize.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "GravityEnsemble.h"
+
+template <class T>
+GravityEnsemble<T>::GravityEnsemble(int voiceCount, int maxBodiesPerVoice)
+{
+    voices = std::max(1, std::min(voiceCount, MaxVoices));
+    lanes = (voices + LaneGroup - 1) / LaneGroup * LaneGroup;
+    maxBodies = std::max(2, maxBodiesPerVoice);
+    count = 0;
+
+    const size_t size = static_cast<size_t>(maxBodies) * lanes;
+    for (std::vector<T> *v : {&x, &y, &vx, &vy, &ax, &ay, &mass, &oldAx, &oldAy, &initX, &initY, &initVx, &initVy, &initMass})
+        v->assign(size, T(0));
+    for (std::vector<T> *v : {&baseX, &baseY, &baseVx, &baseVy, &baseMass})
+        v->assign(maxBodies, T(0));
+
+    gScale.assign(lanes, T(1));
+    softScale.assign(lanes, T(1));
+    seeds.assign(lanes, 0);
+    random.resize(lanes);
+    spread = T(0);
+
+    for (std::vector<T> *v : {&laneDt, &laneG, &laneSoft, &laneMin})
+        v->assign(lanes, T(0));
+    time.assign(lanes, 0.0);
+    stepCount = 0;
+}
+
+// Copies the initial bodies of base into every voice and draws the variation of the voices
+template <class T>
+bool GravityEnsemble<T>::load(const Gravity<T> &base, T variation)
+{
+    if (base.getBodyCount() > maxBodies)
+        return false;
+
+    spread = variation;
+
+    // Seeds follow the base seed, so a seeded [grav] gives the same ensemble every time
+    for (int l = 0; l < lanes; ++l)
+    {
+        int v = l < voices ? l : 0;
+        seeds[l] = base.getSeed() + v;
+        gScale[l] = v == 0 ? T(1) : drawGScale(l);
+        softScale[l] = T(1);
+    }
+
+    return loadBodies(base);
+}
+
+// Factor on G of a varied lane, the first value drawn from its seed
+template <class T>
+T GravityEnsemble<T>::drawGScale(int lane)
+{
+    random[lane].seed(seeds[lane]);
+    return T(1) + spread * static_cast<T>(random[lane].random() * 2.0 - 1.0);
+}
+
+// Takes over the initial bodies of base and restarts the voices
+template <class T>
+bool GravityEnsemble<T>::loadBodies(const Gravity<T> &base)
+{
+    if (base.getBodyCount() > maxBodies)
+        return false;
+
+    count = base.getBodyCount();
+
+    for (int i = 0; i < count; ++i)
+    {
+        Body<T> b = base.getInitBody(i);
+        baseX[i] = b.x;
+        baseY[i] = b.y;
+        baseVx[i] = b.vx;
+        baseVy[i] = b.vy;
+        baseMass[i] = b.mass;
+    }
+
+    reset();
+    return true;
+}
+
+// Restarts every voice from the base bodies. Voices after the first get their velocities varied by their seed.
+template <class T>
+void GravityEnsemble<T>::reset()
+{
+    for (int l = 0; l < lanes; ++l)
+    {
+        int v = l < voices ? l : 0;
+        GravityMath<T> &r = random[l];
+        r.seed(seeds[l]);
+
+        for (int i = 0; i < count; ++i)
+        {
+            size_t k = static_cast<size_t>(i) * lanes + l;
+            T jitter = v == 0 ? T(1) : T(1) + spread * static_cast<T>(r.random() * 2.0 - 1.0);
+
+            initX[k] = baseX[i];
+            initY[k] = baseY[i];
+            initVx[k] = baseVx[i] * jitter;
+            initVy[k] = baseVy[i] * jitter;
+            initMass[k] = baseMass[i];
+        }
+
+        time[l] = 0.0;
+    }
+
+    const size_t n = static_cast<size_t>(count) * lanes;
+    std::copy(initX.begin(), initX.begin() + n, x.begin());
+    std::copy(initY.begin(), initY.begin() + n, y.begin());
+    std::copy(initVx.begin(), initVx.begin() + n, vx.begin());
+    std::copy(initVy.begin(), initVy.begin() + n, vy.begin());
+    std::copy(initMass.begin(), initMass.begin() + n, mass.begin());
+    std::fill(ax.begin(), ax.end(), T(0));
+    std::fill(ay.begin(), ay.end(), T(0));
+    stepCount = 0;
+}
+
+template <class T>
+void GravityEnsemble<T>::setGScale(int voice, T scale)
+{
+    if (voice >= 0 && voice < voices)
+        gScale[voice] = scale;
+}
+
+template <class T>
+void GravityEnsemble<T>::setSoftScale(int voice, T scale)
+{
+    if (voice >= 0 && voice < voices)
+        softScale[voice] = scale;
+}
+
+// The G of a varied voice is drawn again at once, the velocities are drawn by reset()
+template <class T>
+void GravityEnsemble<T>::setSeed(int voice, int seed)
+{
+    if (voice < 0 || voice >= voices)
+        return;
+
+    seeds[voice] = seed;
+
+    if (voice > 0)
+        gScale[voice] = drawGScale(voice);
+}
+
+// Accelerations of all voices. Every body pair is evaluated once for all lanes and acts on both bodies
+// (the half-pairs sum of the symmetric engine), so a step needs one sqrt and division per pair and lane.
+template <class T>
+void GravityEnsemble<T>::computeForces(const T *g, const T *softSqr, const Body<T> &hole)
+{
+    const int L = lanes;
+    const size_t n = static_cast<size_t>(count) * L;
+    const T *px = x.data();
+    const T *py = y.data();
+    const T *pm = mass.data();
+
+    std::fill(ax.begin(), ax.begin() + n, T(0));
+    std::fill(ay.begin(), ay.begin() + n, T(0));
+
+    for (int i = 0; i < count; ++i)
+    {
+        const size_t ti = static_cast<size_t>(i) * L;
+
+        for (int j = i + 1; j < count; ++j)
+        {
+            const size_t tj = static_cast<size_t>(j) * L;
+            T *__restrict aix = &ax[ti];
+            T *__restrict aiy = &ay[ti];
+            T *__restrict ajx = &ax[tj];
+            T *__restrict ajy = &ay[tj];
+
+            // Branch-free pair term, see pairAcceleration in ForceKernelImpl.h
+#pragma omp simd
+            for (int l = 0; l < L; ++l)
+            {
+                T dx = px[tj + l] - px[ti + l];
+                T dy = py[tj + l] - py[ti + l];
+                T r2 = dx * dx + dy * dy;
+                T distSqr = r2 + softSqr[l] * (r2 > T(1) ? r2 : T(1));
+                T invDist = T(1) / std::sqrt(distSqr);
+                T inv3 = (distSqr >= T(MinDistSqr)) ? invDist * invDist * invDist : T(0);
+
+                aix[l] += pm[tj + l] * inv3 * dx;
+                aiy[l] += pm[tj + l] * inv3 * dy;
+                ajx[l] -= pm[ti + l] * inv3 * dx;
+                ajy[l] -= pm[ti + l] * inv3 * dy;
+            }
+        }
+    }
+
+    // The black hole is a source only and the same for every voice
+    const T hx = hole.x, hy = hole.y, hm = hole.mass;
+
+    for (size_t b = 0; b < n; b += L)
+    {
+        T *__restrict outX = &ax[b];
+        T *__restrict outY = &ay[b];
+
+#pragma omp simd
+        for (int l = 0; l < L; ++l)
+        {
+            T dx = hx - px[b + l];
+            T dy = hy - py[b + l];
+            T r2 = dx * dx + dy * dy;
+            T distSqr = r2 + softSqr[l] * (r2 > T(1) ? r2 : T(1));
+            T invDist = T(1) / std::sqrt(distSqr);
+            T w = (distSqr >= T(MinDistSqr)) ? hm * invDist * invDist * invDist : T(0);
+
+            outX[l] = g[l] * (outX[l] + w * dx);
+            outY[l] = g[l] * (outY[l] + w * dy);
+        }
+    }
+}
+
+// One step of every voice, the same phases as Gravity::simulate() without the grid, the force engines
+// and the nudge. Stagnating bodies far from the center still get random impulses from their lane.
+template <class T>
+void GravityEnsemble<T>::simulate(const Gravity<T> &base)
+{
+    const int L = lanes;
+    const T dt = base.getDt();
+    const T posDamping = base.getPosDamping();
+    const T velDamping = base.getVelDamping();
+    const T vmin = base.getVmin();
+    const T vmax = base.getVmax();
+    const T G = base.getG();
+    const T soft = base.getSoftening();
+
+    for (int l = 0; l < L; ++l)
+    {
+        laneG[l] = G * gScale[l];
+        laneSoft[l] = soft * softScale[l] * soft * softScale[l];
+        laneMin[l] = std::numeric_limits<T>::max();
+    }
+
+    // Adaptive dt from the closest pair of each voice
+    T *__restrict minSqr = laneMin.data();
+
+    for (int i = 0; i < count; ++i)
+    {
+        for (int j = i + 1; j < count; ++j)
+        {
+            const T *xi = &x[static_cast<size_t>(i) * L];
+            const T *yi = &y[static_cast<size_t>(i) * L];
+            const T *xj = &x[static_cast<size_t>(j) * L];
+            const T *yj = &y[static_cast<size_t>(j) * L];
+
+#pragma omp simd
+            for (int l = 0; l < L; ++l)
+            {
+                T dx = xj[l] - xi[l];
+                T dy = yj[l] - yi[l];
+                T d2 = dx * dx + dy * dy;
+                minSqr[l] = d2 < minSqr[l] ? d2 : minSqr[l];
+            }
+        }
+    }
+
+    for (int l = 0; l < L; ++l)
+    {
+        T scale = T(0.8) + T(0.8) * std::tanh(std::sqrt(laneMin[l]) * T(0.8));
+        laneDt[l] = std::max(dt * scale, T(0.001));
+    }
+
+    const T *__restrict stepDt = laneDt.data();
+    const size_t n = static_cast<size_t>(count) * L;
+
+    // The first step after a reset needs the accelerations of the initial state, with position damping
+    if (stepCount == 0)
+    {
+        computeForces(laneG.data(), laneSoft.data(), base.getBlackHole());
+
+        for (size_t k = 0; k < n; ++k)
+        {
+            T pdamp = posDamping * (T(1) + std::sqrt(x[k] * x[k] + y[k] * y[k]));
+            ax[k] -= x[k] * pdamp;
+            ay[k] -= y[k] * pdamp;
+        }
+    }
+
+    // Positions (Leapfrog step 1)
+    for (size_t b = 0; b < n; b += L)
+    {
+        T *__restrict px = &x[b];
+        T *__restrict py = &y[b];
+        T *__restrict pax = &ax[b];
+        T *__restrict pay = &ay[b];
+        T *__restrict oax = &oldAx[b];
+        T *__restrict oay = &oldAy[b];
+        const T *__restrict pvx = &vx[b];
+        const T *__restrict pvy = &vy[b];
+
+#pragma omp simd
+        for (int l = 0; l < L; ++l)
+        {
+            T d = stepDt[l];
+            oax[l] = pax[l];
+            oay[l] = pay[l];
+            px[l] += pvx[l] * d + T(0.5) * pax[l] * d * d;
+            py[l] += pvy[l] * d + T(0.5) * pay[l] * d * d;
+        }
+    }
+
+    computeForces(laneG.data(), laneSoft.data(), base.getBlackHole());
+
+    // Position damping, the velocity update (Leapfrog step 2), velocity damping and the speed limits
+    for (size_t b = 0; b < n; b += L)
+    {
+        const T *__restrict px = &x[b];
+        const T *__restrict py = &y[b];
+        T *__restrict pvx = &vx[b];
+        T *__restrict pvy = &vy[b];
+        T *__restrict pax = &ax[b];
+        T *__restrict pay = &ay[b];
+        const T *__restrict oax = &oldAx[b];
+        const T *__restrict oay = &oldAy[b];
+
+#pragma omp simd
+        for (int l = 0; l < L; ++l)
+        {
+            T pdamp = posDamping * (T(1) + std::sqrt(px[l] * px[l] + py[l] * py[l]));
+            pax[l] -= px[l] * pdamp;
+            pay[l] -= py[l] * pdamp;
+
+            T d = stepDt[l];
+            T wx = pvx[l] + T(0.5) * (oax[l] + pax[l]) * d;
+            T wy = pvy[l] + T(0.5) * (oay[l] + pay[l]) * d;
+
+            T vdamp = velDamping * (T(1) + std::sqrt(wx * wx + wy * wy));
+            wx *= T(1) - vdamp;
+            wy *= T(1) - vdamp;
+
+            T speed = std::sqrt(wx * wx + wy * wy);
+            T limit = speed < vmin ? vmin : (speed > vmax ? vmax : speed);
+            T k = speed > T(0) ? limit / speed : T(1);
+
+            pvx[l] = wx * k;
+            pvy[l] = wy * k;
+        }
+    }
+
+    // Minimum speed far from the center, rare enough to stay scalar
+    for (size_t b = 0; b < n; b += L)
+    {
+        for (int l = 0; l < voices; ++l)
+        {
+            size_t k = b + l;
+
+            if (x[k] * x[k] + y[k] * y[k] < T(100.0 * 100.0))
+                continue;
+
+            if (std::sqrt(vx[k] * vx[k] + vy[k] * vy[k]) < vmin && std::sqrt(ax[k] * ax[k] + ay[k] * ay[k]) < T(0.01))
+            {
+                Vector<T> v = random[l].randomImpulse(0.02, 0.07);
+                vx[k] += v.x;
+                vy[k] += v.y;
+            }
+        }
+    }
+
+    for (int l = 0; l < L; ++l)
+        time[l] += laneDt[l];
+
+    stepCount++;
+}
+
+// Copies all voices to out, voice major
+template <class T>
+int GravityEnsemble<T>::copyBodies(Body<T> *out) const
+{
+    for (int v = 0; v < voices; ++v)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            size_t k = static_cast<size_t>(i) * lanes + v;
+            out[v * count + i] = Body<T>{x[k], y[k], vx[k], vy[k], ax[k], ay[k], mass[k]};
+        }
+    }
+
+    return voices * count;
+}
+
+template class GravityEnsemble<float>;
+template class GravityEnsemble<double>;
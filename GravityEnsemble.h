@@ -0,0 +1,81 @@
+// GravityEnsemble.h – Many variations of one system stepped in lockstep
+// Every voice is a full copy of the base system with its own G, softening and seed. The values of
+// all voices are interleaved per body (x[body * lanes + voice]), so every loop of a step runs over the
+// voices on contiguous memory and vectorizes across them, also for systems far smaller than a SIMD
+// register of pair interactions.
+
+#ifndef GRAVITYENSEMBLE_H
+#define GRAVITYENSEMBLE_H
+
+#include <vector>
+#include <cstdint>
+#include "Gravity.h"
+
+template <class T>
+class GravityEnsemble
+{
+public:
+    static const int MaxVoices = 64; // Upper bound for the voice count
+    static const int LaneGroup = 16; // Voices are padded to a multiple of this, one AVX-512 float register
+
+    GravityEnsemble(int voices, int maxBodies); // maxBodies per voice, fixed for the lifetime of the ensemble
+
+    GravityEnsemble(const GravityEnsemble &) = delete;
+    GravityEnsemble &operator=(const GravityEnsemble &) = delete;
+
+    // Copies the initial bodies of base into every voice. Voices after the first vary G and the
+    // initial velocities by up to ±spread (relative), drawn from their seed. False when base has more
+    // bodies than a voice can hold.
+    bool load(const Gravity<T> &base, T spread);
+    bool loadBodies(const Gravity<T> &base); // Takes over new initial bodies of base, keeps the voice settings, resets
+    void reset();                            // Restarts every voice from its initial state
+
+    void setGScale(int voice, T scale);    // Factor on the G of the base system
+    void setSoftScale(int voice, T scale); // Factor on the softening of the base system
+    void setSeed(int voice, int seed);     // Seed of the variation: G at once, velocities and impulses by reset()
+
+    int getVoices() const { return voices; }
+    int getBodyCount() const { return count; } // Bodies per voice
+    int getMaxBodies() const { return maxBodies; }
+    T getGScale(int voice) const { return gScale[voice]; }
+    T getSoftScale(int voice) const { return softScale[voice]; }
+    int getSeed(int voice) const { return seeds[voice]; }
+    uint64_t getStep() const { return stepCount; }
+    double getTime() const { return time[0]; } // Simulated time of the first voice
+
+    // One step of every voice. dt, damping, speed limits and the black hole are read from base,
+    // so the parameter messages of [grav] act on all voices.
+    void simulate(const Gravity<T> &base);
+
+    // Copies all voices to out, voice major: body i of voice v at v * getBodyCount() + i. Returns the count.
+    int copyBodies(Body<T> *out) const;
+
+private:
+    void computeForces(const T *g, const T *softSqr, const Body<T> &hole); // Accelerations of all voices
+    T drawGScale(int lane);                                                // G variation drawn from the seed of lane
+
+    int voices;    // Voices in use
+    int lanes;     // Voices padded to LaneGroup, the padding lanes repeat voice 0
+    int maxBodies; // Bodies per voice
+    int count;     // Active bodies per voice
+
+    std::vector<T> x, y, vx, vy, ax, ay, mass; // Current states, [body * lanes + lane]
+    std::vector<T> oldAx, oldAy;               // Accelerations of the previous step
+    std::vector<T> initX, initY, initVx, initVy, initMass; // Initial states of the voices
+    std::vector<T> baseX, baseY, baseVx, baseVy, baseMass; // Initial bodies of the base system, [body]
+
+    std::vector<T> gScale;    // Per lane factor on G
+    std::vector<T> softScale; // Per lane factor on the softening
+    std::vector<int> seeds;   // Per lane seed
+    std::vector<GravityMath<T>> random; // Per lane random generator
+    T spread;                 // Variation of the voices drawn at reset()
+
+    std::vector<T> laneDt;     // Per lane adaptive dt of the current step
+    std::vector<T> laneG;      // Per lane G of the current step
+    std::vector<T> laneSoft;   // Per lane squared softening of the current step
+    std::vector<T> laneMin;    // Per lane smallest squared pair distance
+    std::vector<double> time;  // Per lane simulated time
+    uint64_t stepCount;        // Steps since the last reset
+};
+
+#endif // GRAVITYENSEMBLE_H
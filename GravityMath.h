@@ -1,45 +1,207 @@
+// GravityMath.h – Math helpers of the simulation core
+// Header only so every helper inlines into the force and integration loops without LTO
+
 #ifndef GRAVITYMATH_H
 #define GRAVITYMATH_H
 
 #include <utility>
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// make bench MATH_INLINE=0 keeps the helpers out of line and out of sight of the optimizer, like the
+// calls into the former GravityMath.cpp without LTO, so the bench can measure what inlining gains
+#if defined(GRAV_MATH_OUTLINE) && defined(__clang__)
+#define GRAV_MATH_HELPER __attribute__((noinline))
+#elif defined(GRAV_MATH_OUTLINE)
+#define GRAV_MATH_HELPER __attribute__((noipa))
+#else
+#define GRAV_MATH_HELPER
+#endif
 
 // Holds delta
+template <class T>
 struct Vector
 {
-    double x;
-    double y;
+    T x;
+    T y;
 };
 
+// Math helpers of the simulation core, T is its scalar type
+template <class T>
 class GravityMath
 {
 public:
-    GravityMath();
+    // Every instance starts with its own random seed, the seed message makes runs reproducible.
+    // The start seed stays below 2^24 so a Pd float can send it back exactly.
+    GravityMath()
+    {
+        std::random_device device;
+        seed(device() & 0xFFFFFF);
+    }
 
     // Calculates the radius of a body relative to the center
-    double calcRadiusFromCenter(double x, double y);
+    GRAV_MATH_HELPER static constexpr T calcRadiusFromCenter(T x, T y)
+    {
+        return x * x + y * y;
+    }
+
     // Calulates the relative position [deltax deltay] of two positions
-    Vector calcRelativePositionVector(double x1, double y1, double x2, double y2) const;
+    GRAV_MATH_HELPER static constexpr Vector<T> calcRelativePositionVector(T x1, T y1, T x2, T y2)
+    {
+        return {x2 - x1, y2 - y1};
+    }
+
     // Calculates the Euclidean distance based on deltax, deltay
-    double calcEuclideanDistance(double dx, double dy) const;
+    GRAV_MATH_HELPER static T calcEuclideanDistance(T dx, T dy)
+    {
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
     // Calculates the Euclidean distance from coordinates
-    double calcEuclideanDistance(double x1, double y1, double x2, double y2) const;
+    GRAV_MATH_HELPER static T calcEuclideanDistance(T x1, T y1, T x2, T y2)
+    {
+        return calcEuclideanDistance(x2 - x1, y2 - y1);
+    }
+
     // Computes position-based damping factor (grows with distance from origin)
-    double calcPositionDamping(double x, double y, double baseDamping) const;
+    GRAV_MATH_HELPER static T calcPositionDamping(T x, T y, T baseDamping)
+    {
+        return baseDamping * (T(1) + std::sqrt(x * x + y * y));
+    }
+
     // Computes velocity magnitude (speed) from vx/vy
-    double calcSpeed(double vx, double vy) const;
+    GRAV_MATH_HELPER static T calcSpeed(T vx, T vy)
+    {
+        return std::sqrt(vx * vx + vy * vy);
+    }
+
     // Computes acceleration from vx/vy
-    double calcAcceleration(double ax, double ay) const;
+    GRAV_MATH_HELPER static T calcAcceleration(T ax, T ay)
+    {
+        return std::sqrt(ax * ax + ay * ay);
+    }
+
+    // Clamps the given velocity to a min/max speed, returns scaled pair
+    GRAV_MATH_HELPER static Vector<T> clampSpeed(T vx, T vy, T vmin, T vmax)
+    {
+        T speed = calcSpeed(vx, vy);
+
+        if (speed == T(0))
+            return {vx, vy};
+
+        if (speed < vmin)
+        {
+            T scale = vmin / speed;
+            return {vx * scale, vy * scale};
+        }
+
+        if (speed > vmax)
+        {
+            T scale = vmax / speed;
+            return {vx * scale, vy * scale};
+        }
+
+        return {vx, vy};
+    }
+
+    // Seeds the random generator, equal seeds give equal random sequences.
+    // splitmix64 spreads the seed over the whole state.
+    void seed(uint64_t value)
+    {
+        seedValue = value;
+
+        uint64_t s = value;
+        for (uint64_t &word : state)
+        {
+            s += 0x9E3779B97F4A7C15ull;
+            uint64_t z = s;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    // Gets the seed of the random generator
+    uint64_t getSeed() const { return seedValue; }
+
+    static const int RandomWords = 5; // Words of saveRandom(): the generator state and the seed
+
+    // Copies the generator state, loadRandom() continues the sequence exactly from there
+    void saveRandom(uint64_t *out) const
+    {
+        for (int i = 0; i < 4; ++i)
+            out[i] = state[i];
+        out[4] = seedValue;
+    }
+
+    void loadRandom(const uint64_t *in)
+    {
+        for (int i = 0; i < 4; ++i)
+            state[i] = in[i];
+        seedValue = in[4];
+    }
+
+    // Generates a random double in [0, 1) from the upper 53 bits
+    double random()
+    {
+        return static_cast<double>(nextRandom() >> 11) * 0x1.0p-53;
+    }
+
+    // Generates a random integer in [0, count)
+    int randomInt(int count)
+    {
+        return static_cast<int>(random() * count);
+    }
+
     // Generates a random angle between 0 and 2π
-    double randomAngle() const;
-    // Generates a random double between min and max
-    double randomRange(double min, double max) const;
+    T randomAngle()
+    {
+        return static_cast<T>(random() * 2.0 * M_PI);
+    }
+
+    // Generates a random value between min and max
+    T randomRange(T min, T max)
+    {
+        return static_cast<T>(min + random() * (max - min));
+    }
+
     // Returns a velocity vector with random direction and magnitude
-    Vector randomImpulse(double minStrength, double maxStrength) const;
-    // Clamps the given velocity to a min/max speed, returns scaled pair
-    Vector clampSpeed(double vx, double vy, double vmin, double vmax) const;
+    Vector<T> randomImpulse(T minStrength, T maxStrength)
+    {
+        T angle = randomAngle();
+        T strength = randomRange(minStrength, maxStrength);
+        return {strength * std::cos(angle), strength * std::sin(angle)};
+    }
 
-protected:
 private:
+    static constexpr uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // Next raw value of xoshiro256**
+    uint64_t nextRandom()
+    {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+
+        return result;
+    }
+
+    uint64_t state[4];  // xoshiro256** state, owned by this instance only
+    uint64_t seedValue; // Seed of the current sequence
 };
 
-#endif // GRAVITYMATH_H
\ No newline at end of file
+#endif // GRAVITYMATH_H
@@ -0,0 +1,46 @@
+// GravityState.h – Binary snapshot of a complete simulation state
+// Gravity::saveState() writes it, Gravity::loadState() restores it, [grav] keeps it in memory slots
+// or in files. The values are native endian (little endian on every supported target).
+//
+// Layout:
+//   GravityStateHeader
+//   scalar[count] x, y, vx, vy, ax, ay, mass of the current bodies, one array after the other
+//   scalar[count] x, y, vx, vy, ax, ay, mass of the initial bodies
+// scalar is float or double as given by realSize, a state of the other precision is converted on load.
+
+#ifndef GRAVITYSTATE_H
+#define GRAVITYSTATE_H
+
+#include <cstdint>
+#include <cstddef>
+
+static const uint32_t GravityStateMagic = 0x53565247; // "GRVS" in little endian
+static const uint32_t GravityStateVersion = 1;
+
+struct GravityStateHeader
+{
+    uint32_t magic;      // GravityStateMagic
+    uint32_t version;    // GravityStateVersion
+    uint32_t realSize;   // Bytes per scalar of the body arrays, 4 or 8
+    uint32_t count;      // Active bodies
+    uint32_t engine;     // ForceEngine
+    uint32_t integrator; // Integrator
+    uint32_t nudgeMode;  // Nudging in progress
+    uint32_t nudgeStep;  // Steps of the nudge done
+    uint64_t step;       // Simulation steps done
+    double time;         // Simulated time
+    double G, dt, posDamping, velDamping, softening, vmin, vmax; // Parameters, posDamping as stored
+    double theta;        // Barnes–Hut opening angle
+    double tolerance;    // RK45 error per step
+    double rkStep;       // Last accepted RK45 substep
+    double holeX, holeY, holeMass; // The black hole
+    uint64_t random[5];  // Random generator state and seed
+};
+
+// Bytes of a state with count bodies of realSize bytes per scalar
+inline size_t gravityStateSize(uint32_t count, uint32_t realSize)
+{
+    return sizeof(GravityStateHeader) + size_t(2) * 7 * count * realSize;
+}
+
+#endif // GRAVITYSTATE_H
@@ -0,0 +1,101 @@
+// ParamQueue.h – Lock-free handover of parameter changes to the simulation thread
+// While a system is stepped by another thread, its setters validate on the calling thread and queue
+// the change, the simulation thread applies all queued changes between two steps. Nothing in a step
+// ever sees a half-applied change, and neither side locks or allocates.
+// Header only like the other queues of the project.
+
+#ifndef PARAMQUEUE_H
+#define PARAMQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "SpscQueue.h"
+
+// What a change sets
+enum class Param
+{
+    G,
+    Dt,
+    PosDamping,
+    VelDamping,
+    Softening,
+    Vmin,
+    Vmax,
+    Theta,
+    Tolerance,
+    Engine,     // value[0]: ForceEngine
+    Integrator, // value[0]: Integrator
+    Simd,       // kernel: the ForceKernel
+    Seed,
+    Nudge,
+    BodyCount,
+    BodyMass,  // index, value[0]: mass
+    Body,      // index, value: x y vx vy mass
+    BlackHole, // value: x y mass
+    Preset,    // index: preset number
+    Reset,
+    State,     // value[0]: serial of the state in the ParamMailbox
+};
+
+// One validated change
+struct ParamChange
+{
+    Param param;        // What is set
+    int index;          // Body or preset index
+    double value[5];    // New values
+    const void *kernel; // Param::Simd only
+};
+
+// Single-producer/single-consumer queue of changes, 4096 per step before new changes get dropped
+typedef SpscQueue<ParamChange, 4096> ParamQueue;
+
+// Latest-wins handover of one block of bytes, e.g. a state to restore. Three buffers: the producer
+// fills its own, publishing swaps it with the middle one, the consumer swaps the middle one with
+// its own when it is newer. Only the buffer the producer holds is ever resized. Every buffer carries
+// the serial it was published with, so a Param::State entry of the queue finds out whether the
+// buffer it got is its own or a newer one whose entry is still to come.
+class ParamMailbox
+{
+public:
+    ParamMailbox() : serials{0, 0, 0}, back(0), front(1), middle(2) {}
+
+    ParamMailbox(const ParamMailbox &) = delete;
+    ParamMailbox &operator=(const ParamMailbox &) = delete;
+
+    // Producer: the buffer to fill before publish()
+    std::vector<unsigned char> &fill() { return buffers[back]; }
+
+    // Producer: hands the filled buffer over, replacing one the consumer has not taken yet
+    void publish(uint64_t serial)
+    {
+        serials[back] = serial;
+        back = middle.exchange(back | Fresh, std::memory_order_acq_rel) & Index;
+    }
+
+    // Consumer: takes over the newest published buffer, if there is one since the last take()
+    void take()
+    {
+        if ((middle.load(std::memory_order_relaxed) & Fresh) == 0)
+            return;
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & Index;
+    }
+
+    // Consumer: the buffer of the last take() and its serial, 0 before the first one
+    const std::vector<unsigned char> &current() const { return buffers[front]; }
+    uint64_t currentSerial() const { return serials[front]; }
+
+private:
+    static const int Index = 3; // Buffer bits of middle
+    static const int Fresh = 4; // Set while the middle buffer was not taken
+
+    std::vector<unsigned char> buffers[3];
+    uint64_t serials[3];     // Serial of each buffer, written with the buffer before publishing
+    int back;                // Held by the producer
+    int front;               // Held by the consumer
+    std::atomic<int> middle; // Buffer in between and the Fresh flag
+};
+
+#endif // PARAMQUEUE_H
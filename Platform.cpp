@@ -0,0 +1,165 @@
+// Platform.cpp – Operating system services of the simulation threads
+
+#include <thread>
+#include <cstdlib>
+#include "Platform.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <mmsystem.h>
+#include <malloc.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <time.h>
+#endif
+
+#if defined(_WIN32)
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Waitable timer of one thread, closed when the thread exits
+struct SleepTimer
+{
+    SleepTimer()
+    {
+        handle = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+        // Older systems only have timers on the global tick, raised to 1 ms once for the process
+        if (handle == nullptr)
+        {
+            static bool raised = timeBeginPeriod(1) == TIMERR_NOERROR;
+            (void)raised;
+            handle = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+    }
+
+    ~SleepTimer()
+    {
+        if (handle != nullptr)
+            CloseHandle(handle);
+    }
+
+    HANDLE handle;
+};
+
+#endif
+
+// Sleeps until t without drifting by a scheduler slice
+void sleepUntilPrecise(PreciseClock::time_point t)
+{
+#if defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC, an absolute deadline cannot oversleep by a lost slice
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+
+    // Only a signal interrupts the sleep, any other error would come back at once
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+        ;
+#elif defined(_WIN32)
+    // Waitable timers take relative due times in 100 ns units, negative
+    static thread_local SleepTimer timer;
+    auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(t - PreciseClock::now()).count();
+
+    if (left <= 0)
+        return;
+
+    if (timer.handle == nullptr)
+    {
+        std::this_thread::sleep_until(t);
+        return;
+    }
+
+    LARGE_INTEGER due;
+    due.QuadPart = -static_cast<LONGLONG>(left / 100);
+
+    if (SetWaitableTimer(timer.handle, &due, 0, nullptr, nullptr, FALSE))
+        WaitForSingleObject(timer.handle, INFINITE);
+#else
+    std::this_thread::sleep_until(t);
+#endif
+}
+
+// Raises the calling thread to real-time priority, 0 restores normal scheduling
+bool setCurrentThreadRealtime(int priority)
+{
+#if defined(_WIN32)
+    return SetThreadPriority(GetCurrentThread(), priority > 0 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL) != 0;
+#else
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param) == 0;
+#endif
+}
+
+// Pins the calling thread to one CPU, -1 allows all
+bool setCurrentThreadAffinity(int cpu)
+{
+#if defined(_WIN32)
+    DWORD_PTR all = 0, system = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &all, &system);
+
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+        return false;
+
+    DWORD_PTR mask = cpu < 0 ? all : (static_cast<DWORD_PTR>(1) << cpu);
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpu < 0)
+    {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            CPU_SET(c, &set);
+    }
+    else
+        CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    // macOS only offers affinity hints, there is no way to pin a thread
+    return cpu < 0;
+#endif
+}
+
+// Real-time priority of the calling thread, time critical counts as 1 on Windows
+int getCurrentThreadRealtime()
+{
+#if defined(_WIN32)
+    return GetThreadPriority(GetCurrentThread()) == THREAD_PRIORITY_TIME_CRITICAL ? 1 : 0;
+#else
+    int policy = SCHED_OTHER;
+    sched_param param{};
+
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 || policy != SCHED_FIFO)
+        return 0;
+
+    return param.sched_priority;
+#endif
+}
+
+// Memory aligned to alignment bytes, nullptr when out of memory
+void *alignedAlloc(size_t bytes, size_t alignment)
+{
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, alignment);
+#else
+    void *p = nullptr;
+    return posix_memalign(&p, alignment, bytes) == 0 ? p : nullptr;
+#endif
+}
+
+void alignedFree(void *p)
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
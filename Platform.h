@@ -0,0 +1,30 @@
+// Platform.h – Operating system services of the simulation threads behind one interface
+// Clock, precise sleep, thread priority and affinity and aligned memory for Linux, macOS and Windows.
+// The system headers stay in Platform.cpp, so including this never pulls in <windows.h>.
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <chrono>
+#include <cstddef>
+
+// Monotonic clock of all timing: CLOCK_MONOTONIC on Linux and macOS, QueryPerformanceCounter on
+// Windows (MinGW and MSVC), both well below a microsecond instead of the 15 ms of GetTickCount
+using PreciseClock = std::chrono::steady_clock;
+static_assert(PreciseClock::is_steady, "the tick deadlines need a monotonic clock");
+
+// Sleeps until t without drifting by a scheduler slice: an absolute clock_nanosleep on Linux, a
+// high resolution waitable timer on Windows (1 ms timer resolution on systems before Windows 10 1803).
+// Wakes up to the wake-up latency of the OS after t, the tick scheduler spins the rest.
+void sleepUntilPrecise(PreciseClock::time_point t);
+
+bool setCurrentThreadRealtime(int priority); // SCHED_FIFO priority 1-99 (time critical on Windows), 0 restores normal
+bool setCurrentThreadAffinity(int cpu);      // Pins the calling thread to one CPU, -1 allows all
+int getCurrentThreadRealtime();              // Real-time priority of the calling thread, 0 for normal
+
+// Memory aligned to alignment bytes (a power of two, at least sizeof(void *)), nullptr when out of memory.
+// Free with alignedFree only.
+void *alignedAlloc(size_t bytes, size_t alignment);
+void alignedFree(void *p);
+
+#endif // PLATFORM_H
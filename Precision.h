@@ -0,0 +1,14 @@
+// Precision.h – Scalar type the Pd externals build the simulation core with
+// Both Gravity<float> and Gravity<double> are compiled, make PRECISION=float|double picks one.
+// float halves the memory traffic and doubles the SIMD width, double keeps long runs stable.
+
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#if defined(GRAV_PRECISION_FLOAT)
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+#endif // PRECISION_H
@@ -0,0 +1,187 @@
+// SharedScheduler.cpp – One simulation clock for all [grav] instances of the process
+
+#include <algorithm>
+#include "SharedScheduler.h"
+
+SharedScheduler::SharedScheduler()
+    : next(0), running(false), overruns(0), skipped(0)
+{
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    requested = std::max(1, std::min(cores, WorkerPool::MaxThreads));
+}
+
+SharedScheduler::~SharedScheduler()
+{
+    stop();
+}
+
+// The scheduler of the process, created by the first instance that uses it
+SharedScheduler &SharedScheduler::instance()
+{
+    static SharedScheduler scheduler;
+    return scheduler;
+}
+
+// Owner of the tick the calling thread runs, stopping it from inside must not wait for itself
+static thread_local void *ticking = nullptr;
+
+// Registers an instance, the batch grows at the next tick
+void SharedScheduler::add(void *owner, Tick tick)
+{
+    std::shared_ptr<Client> c = std::make_shared<Client>();
+    c->owner = owner;
+    c->tick = tick;
+    c->active = false;
+    c->busy = false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    clients.push_back(c);
+}
+
+// Unregisters an instance, the scheduler thread stops with the last active instance
+void SharedScheduler::remove(void *owner)
+{
+    setActive(owner, false);
+
+    std::lock_guard<std::mutex> guard(lock);
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                 [&](const std::shared_ptr<Client> &c) { return c->owner == owner; }),
+                  clients.end());
+}
+
+// Starts or stops stepping an instance. The lock only guards the client list, so this never waits
+// for a whole batch; stopping waits for the tick of this instance alone.
+void SharedScheduler::setActive(void *owner, bool on)
+{
+    int active = 0;
+    std::shared_ptr<Client> client;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        for (const std::shared_ptr<Client> &c : clients)
+        {
+            if (c->owner == owner)
+            {
+                c->active = on;
+                client = c;
+            }
+            active += c->active.load() ? 1 : 0;
+        }
+    }
+
+    if (client && !on && ticking != owner)
+    {
+        while (client->busy.load())
+            std::this_thread::yield();
+    }
+
+    if (active > 0)
+        start();
+    else
+        stop();
+}
+
+// Workers including the scheduler thread, the pool is resized by the scheduler thread itself
+void SharedScheduler::setThreads(int count)
+{
+    requested = std::max(1, std::min(count, WorkerPool::MaxThreads));
+}
+
+// Instances being stepped
+int SharedScheduler::getActive() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<int>(std::count_if(clients.begin(), clients.end(),
+                                          [](const std::shared_ptr<Client> &c) { return c->active.load(); }));
+}
+
+void SharedScheduler::resetStats()
+{
+    overruns = 0;
+    skipped = 0;
+}
+
+// Starts the scheduler thread unless it runs already
+void SharedScheduler::start()
+{
+    if (running.exchange(true))
+        return;
+
+    if (thread.joinable())
+        thread.join();
+
+    thread = std::thread(&SharedScheduler::loop, this);
+}
+
+// Joins the scheduler thread
+void SharedScheduler::stop()
+{
+    // A tick cannot join the thread that waits for it. The thread idles on until the next
+    // start or stop from outside.
+    if (ticking != nullptr)
+        return;
+
+    running = false;
+
+    if (thread.joinable() && thread.get_id() != std::this_thread::get_id())
+        thread.join();
+}
+
+// Steps every active instance once per tick. Workers take the next instance from a shared counter,
+// so large and small systems balance across the cores.
+void SharedScheduler::loop()
+{
+    timing.start(std::chrono::milliseconds(PeriodMs));
+
+    auto work = [&](int, int)
+    {
+        for (int i = next.fetch_add(1, std::memory_order_relaxed); i < static_cast<int>(batch.size());
+             i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            Client &c = *batch[i];
+
+            // An instance stopped since the batch was built is skipped
+            c.busy = true;
+            if (c.active.load())
+            {
+                ticking = c.owner;
+                c.tick(c.owner);
+                ticking = nullptr;
+            }
+            c.busy = false;
+        }
+    };
+
+    while (running.load())
+    {
+        pool.resize(requested.load(std::memory_order_relaxed));
+
+        // Only the batch is built under the lock, the ticks run without it
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            batch.clear();
+            batch.reserve(clients.size());
+            for (const std::shared_ptr<Client> &c : clients)
+            {
+                if (c->active.load())
+                    batch.push_back(c);
+            }
+        }
+
+        next = 0;
+        pool.forEachWorker(work);
+
+        TickResult tick = timing.wait();
+
+        if (tick.late)
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        if (tick.skipped > 0)
+            skipped.fetch_add(tick.skipped, std::memory_order_relaxed);
+    }
+
+    // Helpers are not needed while no instance runs, removed clients are released
+    batch.clear();
+    pool.resize(1);
+}
@@ -0,0 +1,77 @@
+// SharedScheduler.h – One simulation clock for all [grav] instances of the process
+// Instead of a thread per instance, one scheduler thread wakes at every tick and steps all active
+// instances, spread over a small pool of workers that pull the next instance as soon as they are free.
+// A patch with 32 instances then has one wake-up per tick and as many threads as cores.
+
+#ifndef SHAREDSCHEDULER_H
+#define SHAREDSCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "TickScheduler.h"
+#include "WorkerPool.h"
+
+class SharedScheduler
+{
+public:
+    // Runs one tick of an instance
+    typedef void (*Tick)(void *owner);
+
+    static const int PeriodMs = 10; // Tick interval, the same as the simulation thread of one instance
+
+    static SharedScheduler &instance(); // The scheduler of the process
+
+    SharedScheduler(const SharedScheduler &) = delete;
+    SharedScheduler &operator=(const SharedScheduler &) = delete;
+
+    void add(void *owner, Tick tick);    // Registers an instance, it is not stepped before setActive()
+    void remove(void *owner);            // Unregisters an instance, returns once its tick is not running
+    void setActive(void *owner, bool on); // Starts or stops stepping an instance, stopping waits for its tick
+                                          // unless called from inside that tick
+
+    void setThreads(int count); // Workers including the scheduler thread, applied at the next tick
+    int getThreads() const { return requested.load(std::memory_order_relaxed); }
+    int getActive() const;      // Instances being stepped
+
+    TickScheduler &getTiming() { return timing; }                                   // Policy and spin of the common clock
+    uint64_t getOverruns() const { return overruns.load(std::memory_order_relaxed); } // Ticks that ended after their deadline
+    uint64_t getSkipped() const { return skipped.load(std::memory_order_relaxed); }   // Ticks dropped by the policy
+    void resetStats();
+
+private:
+    // The ticks run without the lock. A worker raises busy before it reads active, stopping clears
+    // active before it waits for busy, so after the wait the tick is over and will not start again.
+    struct Client
+    {
+        void *owner;              // The instance
+        Tick tick;                // Its tick function
+        std::atomic<bool> active; // Stepped at every tick
+        std::atomic<bool> busy;   // A worker is inside the tick or about to check active
+    };
+
+    SharedScheduler();
+    ~SharedScheduler();
+
+    void loop();  // Scheduler thread
+    void start(); // Starts the scheduler thread, lock not held
+    void stop();  // Joins the scheduler thread, lock not held
+
+    mutable std::mutex lock;                      // Guards clients, held while the batch is built
+    std::vector<std::shared_ptr<Client>> clients; // Registered instances
+    std::vector<std::shared_ptr<Client>> batch;   // Active instances of the running tick, scheduler thread only.
+                                                  // Keeps a removed client alive until the tick is over.
+    std::atomic<int> next;         // Next batch entry a worker takes
+    std::thread thread;            // Scheduler thread, runs while any instance is active
+    std::atomic<bool> running;     // Scheduler thread control flag
+    std::atomic<int> requested;    // Worker count set by setThreads
+    WorkerPool pool;               // Workers of the scheduler thread
+    TickScheduler timing;          // Deadlines of the common clock
+    std::atomic<uint64_t> overruns; // Ticks that ended after their deadline
+    std::atomic<uint64_t> skipped;  // Ticks dropped by the policy
+};
+
+#endif // SHAREDSCHEDULER_H
@@ -0,0 +1,129 @@
+// SharedSnapshot.h – Latest frame of a named [grav], readable by any number of analysers
+// [grav sun] binds a GravShare to the symbol sun, [gravf distance sun 3 7] finds it through the symbol
+// and reads the bodies without any atom lists in between. The writer never waits: readers copy under
+// a sequence lock and retry when a frame was written meanwhile.
+
+#ifndef SHAREDSNAPSHOT_H
+#define SHAREDSNAPSHOT_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include "m_pd.h"
+#include "SnapshotRing.h"
+
+// One body as the analysers see it, single precision whatever the core runs in
+struct SharedBody
+{
+    float x, y;   // Position
+    float vx, vy; // Velocity
+    float ax, ay; // Acceleration
+    float mass;   // Mass
+};
+
+class SharedSnapshot
+{
+public:
+    static const int Version = 1;    // Layout of this class, checked by the readers of another binary
+    static const int MaxRetries = 8; // Reads that may collide with the writer before read() gives up
+
+    SharedSnapshot(int maxBodies)
+        : version(Version), capacity(maxBodies), bodies(maxBodies), sequence(0), count(0), frame(0), hole{}
+    {
+    }
+
+    SharedSnapshot(const SharedSnapshot &) = delete;
+    SharedSnapshot &operator=(const SharedSnapshot &) = delete;
+
+    int getVersion() const { return version; }
+    int getCapacity() const { return capacity; }
+
+    // Writer: replaces the shared frame
+    void write(const Snapshot &s)
+    {
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+
+        // Odd while writing
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        int n = s.count < capacity ? s.count : capacity;
+
+        for (int i = 0; i < n; ++i)
+            bodies[i] = convert(s.bodies[i]);
+
+        hole = convert(s.hole);
+        count = n;
+        frame = s.frame;
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader: calls copy(bodies, count, hole, frame) on a consistent frame. copy may run more than once
+    // and must only copy what it needs. False when the writer kept colliding or nothing was written yet.
+    template <class Copy>
+    bool read(Copy copy) const
+    {
+        for (int attempt = 0; attempt < MaxRetries; ++attempt)
+        {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+
+            if (before == 0)
+                return false;
+            // A writer preempted in the middle of a frame needs the CPU to finish it
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            copy(bodies.data(), count, hole, frame);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+
+        return false;
+    }
+
+private:
+    static SharedBody convert(const Body<Real> &b)
+    {
+        return SharedBody{static_cast<float>(b.x), static_cast<float>(b.y), static_cast<float>(b.vx), static_cast<float>(b.vy),
+                          static_cast<float>(b.ax), static_cast<float>(b.ay), static_cast<float>(b.mass)};
+    }
+
+    int version;                    // Version at construction
+    int capacity;                   // Bodies the frame can hold
+    std::vector<SharedBody> bodies; // Bodies of the frame
+    std::atomic<uint64_t> sequence; // Frames written times two, odd while writing
+    int count;                      // Bodies in the frame
+    uint64_t frame;                 // Frame number of the snapshot ring
+    SharedBody hole;                // The black hole
+};
+
+// What [grav <name>] binds to its name
+struct GravShare
+{
+    t_pd pd;                  // Class GravShareClass
+    SharedSnapshot *snapshot; // Frame of the [grav]
+};
+
+static const char *const GravShareClass = "grav-share";
+
+// Shared frame bound to name, nullptr when no [grav] uses the name
+inline SharedSnapshot *findSharedSnapshot(t_symbol *name)
+{
+    t_pd *thing = name->s_thing;
+
+    if (thing == nullptr || std::strcmp(class_getname(*thing), GravShareClass) != 0)
+        return nullptr;
+
+    SharedSnapshot *snapshot = reinterpret_cast<GravShare *>(thing)->snapshot;
+    return snapshot->getVersion() == SharedSnapshot::Version ? snapshot : nullptr;
+}
+
+#endif // SHAREDSNAPSHOT_H
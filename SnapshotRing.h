@@ -0,0 +1,106 @@
+// SnapshotRing.h – Lock-free single-producer/single-consumer ring of simulation snapshots
+// All slots are allocated up front, publishing and reading a frame never allocates or locks.
+// Header only so every external of the project can read the frames.
+
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "SpscQueue.h"
+#include "BodyStore.h"
+#include "Precision.h"
+
+// One published simulation state
+struct Snapshot
+{
+    uint64_t frame;     // Frame number from 1, consecutive for every frame the producer attempted to publish
+    uint64_t step;      // Simulation steps done when the frame was taken
+    double time;        // Simulated time when the frame was taken
+    int64_t wall;       // steady_clock nanoseconds when the frame was published
+    int count;          // Active bodies in this frame
+    Body<Real> hole;    // The black hole
+    Body<Real> *bodies; // Active bodies, points into the ring storage
+};
+
+class SnapshotRing
+{
+public:
+    static const int Slots = 4; // Frames the consumer may fall behind before frames get dropped
+
+    explicit SnapshotRing(int maxBodies)
+        : storage(static_cast<size_t>(maxBodies) * (Slots + 1)), capacity(maxBodies), nextFrame(1)
+    {
+        for (int s = 0; s < Slots; ++s)
+        {
+            ring.slot(s) = Snapshot{};
+            ring.slot(s).bodies = &storage[static_cast<size_t>(s) * maxBodies];
+        }
+
+        spare = Snapshot{};
+        spare.bodies = &storage[static_cast<size_t>(Slots) * maxBodies];
+    }
+
+    SnapshotRing(const SnapshotRing &) = delete;
+    SnapshotRing &operator=(const SnapshotRing &) = delete;
+
+    int getCapacity() const { return capacity; } // Bodies one snapshot can hold
+
+    // Producer: slot for the next frame. When the consumer is behind this is a spare slot of the producer,
+    // so the frame still reaches the other readers of the producer and is only dropped for the consumer.
+    // The frame number is used up either way, so the consumer sees the gap.
+    Snapshot *beginWrite()
+    {
+        Snapshot *s = ring.beginPush();
+        queued = s != nullptr;
+
+        if (s == nullptr)
+            s = &spare;
+
+        s->frame = nextFrame++;
+        return s;
+    }
+
+    // Producer: makes the slot from beginWrite visible to the consumer, false when it was dropped.
+    // The slot stays valid for the producer until the next beginWrite.
+    bool endWrite()
+    {
+        if (queued)
+            ring.endPush();
+        return queued;
+    }
+
+    // Consumer: newest published frame, older unread frames are skipped. nullptr when nothing is new.
+    // The frame stays valid until release().
+    const Snapshot *latest()
+    {
+        release();
+
+        const Snapshot *s = ring.latest();
+        pending = s != nullptr;
+        return s;
+    }
+
+    // Consumer: hands the frame returned by latest() back to the producer
+    void release()
+    {
+        if (!pending)
+            return;
+
+        pending = false;
+        ring.pop();
+    }
+
+private:
+    std::vector<Body<Real>> storage; // Body arrays of all slots and the spare
+    SpscQueue<Snapshot, Slots> ring; // The frames, filled in place
+    int capacity;                    // Bodies per slot
+
+    alignas(64) uint64_t nextFrame; // Producer only
+    Snapshot spare;                 // Producer only: frame the consumer had no room for
+    bool queued = false;            // Producer only: the slot of beginWrite is in the ring
+    bool pending = false;           // Consumer only: a frame from latest() is still in use
+};
+
+#endif // SNAPSHOTRING_H
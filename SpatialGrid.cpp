@@ -0,0 +1,98 @@
+// SpatialGrid.cpp – Uniform spatial hash grid for neighbour queries
+
+#include <algorithm>
+#include "SpatialGrid.h"
+
+template <class T>
+SpatialGrid<T>::SpatialGrid()
+    : posX(nullptr), posY(nullptr), bodyCount(0), mask(0), cellSize(T(1)), invCell(T(1))
+{
+}
+
+// Preallocates the tables for maxBodies, at least two buckets per body
+template <class T>
+void SpatialGrid<T>::reserve(int maxBodies)
+{
+    uint32_t buckets = 16;
+    while (buckets < static_cast<uint32_t>(maxBodies) * 2)
+        buckets <<= 1;
+
+    mask = buckets - 1;
+    bucketStart.assign(buckets + 1, 0);
+    entries.assign(maxBodies, 0);
+    keys.assign(maxBodies, 0);
+}
+
+// Sorts the bodies into cells of the given size (counting sort, O(N))
+template <class T>
+void SpatialGrid<T>::build(const T *x, const T *y, int count, T cell)
+{
+    posX = x;
+    posY = y;
+    bodyCount = count;
+    cellSize = cell;
+    invCell = T(1) / cell;
+
+    std::fill(bucketStart.begin(), bucketStart.end(), 0);
+
+    for (int i = 0; i < count; ++i)
+    {
+        keys[i] = hash(cellCoord(x[i]), cellCoord(y[i]));
+        bucketStart[keys[i]]++;
+    }
+
+    // Inclusive prefix sum: bucketStart[b] is the end of bucket b, the last slot holds count
+    for (uint32_t b = 1; b <= mask; ++b)
+        bucketStart[b] += bucketStart[b - 1];
+    bucketStart[mask + 1] = count;
+
+    // Filling back to front moves every bucketStart[b] down to the start of bucket b
+    for (int i = count - 1; i >= 0; --i)
+        entries[--bucketStart[keys[i]]] = i;
+}
+
+// Smallest pairwise distance, capped at limit. Around every body the cells are searched ring by
+// ring: a body in ring k is at least k - 1 cells away, so the search ends as soon as that is no
+// closer than the nearest pair found so far. Dense systems stop after the 3x3 cells, sparse ones
+// go out to limit, the result equals min(limit, all-pairs scan).
+template <class T>
+T SpatialGrid<T>::minDistance(T limit) const
+{
+    T minSqr = limit * limit;
+
+    for (int i = 0; i < bodyCount; ++i)
+    {
+        const T px = posX[i];
+        const T py = posY[i];
+
+        auto pair = [&](int j)
+        {
+            if (j <= i)
+                return;
+
+            T dx = posX[j] - px;
+            T dy = posY[j] - py;
+            T d = dx * dx + dy * dy;
+            if (d < minSqr)
+                minSqr = d;
+        };
+
+        const int64_t cx = cellCoord(px);
+        const int64_t cy = cellCoord(py);
+
+        for (int64_t ring = 0;; ++ring)
+        {
+            T reach = static_cast<T>(ring - 1) * cellSize;
+
+            if (ring >= 2 && minSqr <= reach * reach)
+                break;
+
+            forRing(cx, cy, ring, pair);
+        }
+    }
+
+    return std::sqrt(minSqr);
+}
+
+template class SpatialGrid<float>;
+template class SpatialGrid<double>;
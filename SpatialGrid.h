@@ -0,0 +1,98 @@
+// SpatialGrid.h – Uniform spatial hash grid for neighbour queries
+// Rebuilt once per step with a counting sort, queries only look at the 3x3 cells around a point
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+template <class T>
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+
+    void reserve(int maxBodies);                                // Preallocates the tables for maxBodies
+    void build(const T *x, const T *y, int count, T cell);      // Sorts the bodies into cells of the given size
+    T minDistance(T limit) const;                               // Smallest pairwise distance, capped at limit
+
+    T getCellSize() const { return cellSize; }
+
+    // Calls f(j) once for every body in the 3x3 cells around (px, py).
+    // Covers every body closer than the cell size; the caller filters by distance.
+    template <class F>
+    void forNeighbours(T px, T py, F f) const
+    {
+        int64_t cx = cellCoord(px);
+        int64_t cy = cellCoord(py);
+        uint32_t visited[9];
+        int visitedCount = 0;
+
+        for (int64_t oy = -1; oy <= 1; ++oy)
+        {
+            for (int64_t ox = -1; ox <= 1; ++ox)
+            {
+                uint32_t bucket = hash(cx + ox, cy + oy);
+
+                // Different cells may share a bucket, visit each bucket only once
+                bool seen = false;
+                for (int v = 0; v < visitedCount; ++v)
+                    seen = seen || visited[v] == bucket;
+
+                if (seen)
+                    continue;
+
+                visited[visitedCount++] = bucket;
+
+                for (int k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k)
+                    f(entries[k]);
+            }
+        }
+    }
+
+private:
+    // Calls f(j) for every body in the cells at Chebyshev distance ring around cell (cx, cy).
+    // Several cells may share a bucket, so f can see a body more than once.
+    template <class F>
+    void forRing(int64_t cx, int64_t cy, int64_t ring, F &f) const
+    {
+        for (int64_t oy = -ring; oy <= ring; ++oy)
+        {
+            // Inner rows of the ring only have their two end cells
+            const int64_t step = (oy == -ring || oy == ring || ring == 0) ? 1 : 2 * ring;
+
+            for (int64_t ox = -ring; ox <= ring; ox += step)
+            {
+                uint32_t bucket = hash(cx + ox, cy + oy);
+
+                for (int k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k)
+                    f(entries[k]);
+            }
+        }
+    }
+
+    int64_t cellCoord(T v) const
+    {
+        T c = std::floor(v * invCell);
+        return std::isfinite(c) ? static_cast<int64_t>(c) : 0;
+    }
+
+    uint32_t hash(int64_t cx, int64_t cy) const
+    {
+        return (static_cast<uint32_t>(cx) * 73856093u ^ static_cast<uint32_t>(cy) * 19349663u) & mask;
+    }
+
+    std::vector<int> bucketStart; // Start of each bucket in entries, size buckets + 1
+    std::vector<int> entries;     // Body indices sorted by bucket
+    std::vector<uint32_t> keys;   // Bucket of each body
+    const T *posX;                // Positions used for the last build
+    const T *posY;
+    int bodyCount;                // Bodies in the last build
+    uint32_t mask;                // Number of buckets - 1
+    T cellSize;                   // Cell edge length
+    T invCell;                    // 1 / cell edge length
+};
+
+#endif // SPATIALGRID_H
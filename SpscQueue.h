@@ -0,0 +1,101 @@
+// SpscQueue.h – Lock-free single-producer/single-consumer ring of fixed capacity
+// The ring of the event queue, the parameter queue and the snapshot ring. Pushing and draining
+// never allocates or locks, a full ring drops new entries and counts them.
+// Header only so every external of the project can use it.
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+template <class T, size_t Capacity>
+class SpscQueue
+{
+public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "the capacity must be a power of two");
+
+    SpscQueue() : head(0), tail(0), dropped(0) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer: appends a copy of v, false when the ring is full and v is dropped
+    bool push(const T &v)
+    {
+        T *slot = beginPush();
+
+        if (slot == nullptr)
+            return false;
+
+        *slot = v;
+        endPush();
+        return true;
+    }
+
+    // Producer: the slot for the next entry to be filled in place, nullptr when the ring is full
+    // and the entry is dropped. endPush() makes it visible.
+    T *beginPush()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (h - tail.load(std::memory_order_acquire) == Capacity)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &items[h % Capacity];
+    }
+
+    void endPush()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest entry, nullptr when the ring is empty. Valid until pop().
+    const T *peek() const
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t == head.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &items[t % Capacity];
+    }
+
+    // Consumer: newest entry, the older ones are handed back unread. nullptr when the ring is empty.
+    // Valid until pop().
+    const T *latest()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+
+        if (t == h)
+            return nullptr;
+
+        tail.store(h - 1, std::memory_order_release);
+        return &items[(h - 1) % Capacity];
+    }
+
+    // Consumer: removes the entry returned by peek() or latest()
+    void pop()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Storage of slot i, only to prepare the slots before the ring is used
+    T &slot(size_t i) { return items[i]; }
+
+    uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); } // Entries lost to a full ring
+    void resetDropped() { dropped = 0; }
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head; // Entries pushed, written by the producer
+    alignas(64) std::atomic<size_t> tail; // Entries popped, written by the consumer
+    std::atomic<uint64_t> dropped;        // Entries the producer could not queue
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,121 @@
+// StateFile.cpp – State files of [grav], read through a memory mapping
+
+#include <cstdio>
+#include <string>
+#include "StateFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : view(nullptr), length(0), handle(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER bytes;
+    HANDLE mapping = nullptr;
+
+    if (GetFileSizeEx(file, &bytes) && bytes.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    CloseHandle(file);
+
+    if (mapping == nullptr)
+        return false;
+
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    handle = reinterpret_cast<intptr_t>(mapping);
+    length = static_cast<size_t>(bytes.QuadPart);
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void *p = MAP_FAILED;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file referenced
+    ::close(fd);
+
+    if (p == MAP_FAILED)
+        return false;
+
+    view = p;
+    length = static_cast<size_t>(info.st_size);
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (view == nullptr)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(view);
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+    handle = 0;
+#else
+    munmap(view, length);
+#endif
+
+    view = nullptr;
+    length = 0;
+}
+
+bool writeStateFile(const char *path, const void *data, size_t size)
+{
+    std::string temp = std::string(path) + ".tmp";
+    FILE *f = std::fopen(temp.c_str(), "wb");
+
+    if (f == nullptr)
+        return false;
+
+    bool ok = std::fwrite(data, 1, size, f) == size;
+    ok = std::fclose(f) == 0 && ok;
+
+    if (ok)
+    {
+#if defined(_WIN32)
+        // rename() does not replace an existing file on Windows
+        ok = MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = std::rename(temp.c_str(), path) == 0;
+#endif
+    }
+
+    if (!ok)
+        std::remove(temp.c_str());
+
+    return ok;
+}
@@ -0,0 +1,36 @@
+// StateFile.h – State files of [grav], read through a memory mapping
+// A file holds one state of Gravity::saveState() (layout in GravityState.h). Loading maps the file
+// and restores the bodies straight from the mapping, nothing is read into a buffer first.
+
+#ifndef STATEFILE_H
+#define STATEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const char *path); // Maps the file, false if it cannot be opened or is empty
+    void close();                // Unmaps the file
+
+    const void *data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    void *view;      // Start of the mapping
+    size_t length;   // Bytes mapped
+    intptr_t handle; // Mapping handle on Windows, unused elsewhere
+};
+
+// Writes size bytes to path through a temporary file, so a failed save keeps the old file intact
+bool writeStateFile(const char *path, const void *data, size_t size);
+
+#endif // STATEFILE_H
@@ -0,0 +1,58 @@
+// TickScheduler.cpp – Fixed-rate timing for the simulation thread
+
+#include "TickScheduler.h"
+#include "CpuRelax.h"
+
+TickScheduler::TickScheduler()
+    : policy(TickPolicy::CatchUp), spin_us(DefaultSpinUs), period(std::chrono::milliseconds(10))
+{
+}
+
+// Starts the schedule, the first deadline is one period from now
+void TickScheduler::start(clock::duration p)
+{
+    period = p;
+    deadline = clock::now() + period;
+}
+
+// Waits for the next deadline. A late tick runs at once under CatchUp; under Drop, or when
+// CatchUp falls more than MaxCatchUp ticks behind, the missed deadlines are skipped.
+TickResult TickScheduler::wait()
+{
+    TickResult result{false, 0};
+    clock::time_point now = clock::now();
+
+    if (now >= deadline)
+    {
+        result.late = true;
+        int behind = static_cast<int>((now - deadline) / period);
+
+        if (policy == TickPolicy::Drop || behind > MaxCatchUp)
+        {
+            // Stay on the original grid so the phase of the output does not drift
+            result.skipped = behind + 1;
+            deadline += period * result.skipped;
+        }
+        else
+        {
+            deadline += period;
+            return result;
+        }
+    }
+
+    sleepUntil(deadline);
+    deadline += period;
+    return result;
+}
+
+// Absolute sleep to spin_us before t, then spins the rest
+void TickScheduler::sleepUntil(clock::time_point t) const
+{
+    clock::time_point wake = t - std::chrono::microseconds(spin_us.load());
+
+    if (clock::now() < wake)
+        sleepUntilPrecise(wake);
+
+    while (clock::now() < t)
+        cpuRelax();
+}
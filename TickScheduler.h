@@ -0,0 +1,54 @@
+// TickScheduler.h – Fixed-rate timing for the simulation thread
+// Deadlines are absolute, so sleeping late never shifts the following ticks. The thread sleeps
+// until shortly before the deadline and spins the rest, which removes the wake-up jitter of the OS.
+
+#ifndef TICKSCHEDULER_H
+#define TICKSCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include "Platform.h"
+
+// What happens to ticks whose deadline has passed when the previous tick ends
+enum class TickPolicy
+{
+    CatchUp, // Run them back to back until the schedule is met again (up to MaxCatchUp ticks)
+    Drop,    // Skip them and continue with the next deadline in the future
+};
+
+// Outcome of one wait
+struct TickResult
+{
+    bool late;   // The deadline had already passed when wait() was called
+    int skipped; // Ticks that will not run
+};
+
+class TickScheduler
+{
+public:
+    using clock = PreciseClock;
+
+    static const int MaxCatchUp = 4;      // Ticks run back to back before the schedule is reset
+    static const int DefaultSpinUs = 200; // Default spin window before a deadline
+    static const int MaxSpinUs = 5000;    // Upper bound for the spin window
+
+    TickScheduler();
+
+    void setPolicy(TickPolicy p) { policy = p; }          // Thread-safe
+    void setSpin(int us) { spin_us = us; }                // Thread-safe, 0 disables spinning
+    TickPolicy getPolicy() const { return policy; }
+    int getSpin() const { return spin_us; }
+
+    void start(clock::duration period); // Starts the schedule, the first deadline is one period from now
+    TickResult wait();                  // Waits for the next deadline, call once per tick
+
+private:
+    void sleepUntil(clock::time_point t) const; // Absolute sleep, then spins the last spin_us
+
+    std::atomic<TickPolicy> policy;
+    std::atomic<int> spin_us;
+    clock::duration period;
+    clock::time_point deadline;
+};
+
+#endif // TICKSCHEDULER_H
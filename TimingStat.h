@@ -0,0 +1,118 @@
+// TimingStat.h – Low overhead duration statistics (count, min, mean, max, percentiles)
+// Recording is a handful of relaxed atomic adds, so it can stay enabled permanently.
+// Any thread may read while one thread records; values of a concurrent read may be one sample apart.
+
+#ifndef TIMINGSTAT_H
+#define TIMINGSTAT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+class TimingStat
+{
+public:
+    TimingStat() { reset(); }
+
+    TimingStat(const TimingStat &) = delete;
+    TimingStat &operator=(const TimingStat &) = delete;
+
+    // Adds one duration in nanoseconds
+    void record(uint64_t ns)
+    {
+        samples.fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(ns, std::memory_order_relaxed);
+        histogram[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+
+        // The writer is usually alone, so these rarely loop
+        uint64_t low = smallest.load(std::memory_order_relaxed);
+        while (ns < low && !smallest.compare_exchange_weak(low, ns, std::memory_order_relaxed))
+            ;
+
+        uint64_t high = largest.load(std::memory_order_relaxed);
+        while (ns > high && !largest.compare_exchange_weak(high, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    // Forgets all samples
+    void reset()
+    {
+        samples.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        smallest.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        largest.store(0, std::memory_order_relaxed);
+
+        for (std::atomic<uint64_t> &b : histogram)
+            b.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return samples.load(std::memory_order_relaxed); } // Recorded samples
+    uint64_t maximum() const { return largest.load(std::memory_order_relaxed); } // Longest sample, 0 when empty
+
+    // Shortest sample, 0 when empty
+    uint64_t minimum() const
+    {
+        return count() == 0 ? 0 : smallest.load(std::memory_order_relaxed);
+    }
+
+    // Average sample, 0 when empty
+    double mean() const
+    {
+        uint64_t n = count();
+        return n == 0 ? 0.0 : static_cast<double>(total.load(std::memory_order_relaxed)) / n;
+    }
+
+    // Upper bound of the bucket holding the q-quantile (q in [0, 1]), within 25 % of the true value
+    uint64_t percentile(double q) const
+    {
+        uint64_t n = count();
+
+        if (n == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(q * n);
+        uint64_t seen = 0;
+
+        for (int b = 0; b < Buckets; ++b)
+        {
+            seen += histogram[b].load(std::memory_order_relaxed);
+
+            if (seen > rank)
+                return std::min(upperBound(b), maximum());
+        }
+
+        return maximum();
+    }
+
+private:
+    // Four buckets per power of two; values below 8 ns get a bucket each
+    static const int Buckets = 64 * 4;
+
+    static int bucket(uint64_t ns)
+    {
+        if (ns < 8)
+            return static_cast<int>(ns);
+
+        int exponent = 63 - __builtin_clzll(ns);
+        return exponent * 4 + static_cast<int>((ns >> (exponent - 2)) & 3);
+    }
+
+    static uint64_t upperBound(int b)
+    {
+        if (b < 8)
+            return static_cast<uint64_t>(b);
+
+        int exponent = b / 4;
+        uint64_t step = uint64_t(1) << (exponent - 2);
+        return (4 + static_cast<uint64_t>(b % 4)) * step + step - 1;
+    }
+
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> smallest;
+    std::atomic<uint64_t> largest;
+    std::atomic<uint64_t> histogram[Buckets];
+};
+
+#endif // TIMINGSTAT_H
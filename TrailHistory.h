@@ -0,0 +1,125 @@
+// TrailHistory.h – Ring of past body positions for drawing orbits
+// Filled by the thread that publishes frames, read by the Pd thread. The writer never waits:
+// a reader detects samples that were overwritten while it copied them and leaves them out.
+// Header only so every external of the project can keep trails.
+
+#ifndef TRAILHISTORY_H
+#define TRAILHISTORY_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "SnapshotRing.h"
+
+class TrailHistory
+{
+public:
+    static const int MaxPoints = 1 << 22; // Positions over all bodies and samples, bounds the ring to 32 MB
+
+    TrailHistory(int maxBodies)
+        : bodies(maxBodies), length(0), every(1), started(0), written(0), frames(0)
+    {
+    }
+
+    TrailHistory(const TrailHistory &) = delete;
+    TrailHistory &operator=(const TrailHistory &) = delete;
+
+    // Samples kept per body, 0 disables the history. Clears the trails.
+    // Allocates, so it must not run concurrently with record(). False when the ring would exceed MaxPoints.
+    bool resize(int samples)
+    {
+        if (samples < 0 || static_cast<int64_t>(samples) * bodies > MaxPoints)
+            return false;
+
+        length = samples;
+        points.assign(static_cast<size_t>(samples) * bodies * 2, 0.0f);
+        scratch.assign(static_cast<size_t>(samples) * 2, 0.0f);
+        started = 0;
+        written = 0;
+        frames = 0;
+        return true;
+    }
+
+    int getLength() const { return length; }        // Samples kept per body
+    int getEvery() const { return every; }          // Published frames per sample
+    void setEvery(int n) { every = n > 0 ? n : 1; } // Thread-safe
+
+    // Writer: stores the positions of one frame, every getEvery() frames
+    void record(const Snapshot &frame)
+    {
+        if (length == 0 || ++frames % every.load(std::memory_order_relaxed) != 0)
+            return;
+
+        uint64_t w = written.load(std::memory_order_relaxed);
+
+        // Readers that see any of the new positions also see started, and drop the sample this overwrites
+        started.store(w + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        float *row = &points[static_cast<size_t>(w % length) * bodies * 2];
+        int count = frame.count < bodies ? frame.count : bodies;
+
+        for (int i = 0; i < count; ++i)
+        {
+            row[i * 2] = static_cast<float>(frame.bodies[i].x);
+            row[i * 2 + 1] = static_cast<float>(frame.bodies[i].y);
+        }
+
+        written.store(w + 1, std::memory_order_release);
+    }
+
+    // Reader: trail of one body, oldest first, as at most maxPoints positions spread evenly over the stored
+    // samples (0 for all). Calls put(x, y) for each point and returns the number of points.
+    template <class Put>
+    int trail(int body, int maxPoints, Put put)
+    {
+        if (length == 0 || body < 0 || body >= bodies)
+            return 0;
+
+        uint64_t end = written.load(std::memory_order_acquire);
+        uint64_t begin = end > static_cast<uint64_t>(length) ? end - length : 0;
+
+        for (uint64_t k = begin; k < end; ++k)
+        {
+            const float *p = &points[static_cast<size_t>(k % length) * bodies * 2 + body * 2];
+            scratch[(k - begin) * 2] = p[0];
+            scratch[(k - begin) * 2 + 1] = p[1];
+        }
+
+        // Samples the writer has reused since the copy started are dropped from the front
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t busy = started.load(std::memory_order_relaxed);
+        uint64_t valid = busy > static_cast<uint64_t>(length) ? busy - length : 0;
+        size_t skip = valid > begin ? static_cast<size_t>(valid - begin) : 0;
+        size_t available = static_cast<size_t>(end - begin);
+
+        if (skip >= available)
+            return 0;
+
+        available -= skip;
+        size_t n = (maxPoints > 0 && static_cast<size_t>(maxPoints) < available) ? maxPoints : available;
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            // Evenly spaced, always including the oldest and the newest sample
+            size_t k = skip + (n > 1 ? j * (available - 1) / (n - 1) : available - 1);
+            put(scratch[k * 2], scratch[k * 2 + 1]);
+        }
+
+        return static_cast<int>(n);
+    }
+
+private:
+    std::vector<float> points;  // length samples of x y for every body
+    std::vector<float> scratch; // Reader copy of one trail
+    int bodies;                 // Bodies per sample
+    int length;                 // Samples per body
+
+    std::atomic<int> every;                    // Published frames per sample
+    alignas(64) std::atomic<uint64_t> started; // Samples begun, written by the writer
+    std::atomic<uint64_t> written;             // Samples completed, written by the writer
+    uint64_t frames;                           // Writer only: frames seen
+};
+
+#endif // TRAILHISTORY_H
@@ -0,0 +1,106 @@
+// TrajectoryWriter.cpp – Offline renders of a simulation as a multichannel WAV file
+
+#include <cstring>
+#include "TrajectoryWriter.h"
+
+TrajectoryWriter::TrajectoryWriter()
+    : file(nullptr), channels(0), rate(0), frames(0), failed(false)
+{
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+// Appends one little endian value to the header
+template <class V>
+static unsigned char *put(unsigned char *p, V value)
+{
+    std::memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+bool TrajectoryWriter::open(const char *path, int channels, int rate)
+{
+    close();
+
+    // The byte rate of the header is 32 bit as well
+    if (channels < 1 || channels > MaxChannels || rate < 1 ||
+        static_cast<uint64_t>(rate) * channels * sizeof(float) > 0xFFFFFFFFull)
+        return false;
+
+    file = std::fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+
+    std::setvbuf(file, nullptr, _IOFBF, BufferBytes);
+
+    this->channels = channels;
+    this->rate = rate;
+    frames = 0;
+    failed = false;
+
+    // Written again with the final sizes on close
+    if (!writeHeader())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool TrajectoryWriter::writeHeader()
+{
+    const uint32_t frameBytes = static_cast<uint32_t>(channels) * sizeof(float);
+    const uint32_t dataBytes = static_cast<uint32_t>(frames * frameBytes);
+
+    unsigned char header[HeaderBytes];
+    unsigned char *p = header;
+
+    std::memcpy(p, "RIFF", 4);
+    p = put<uint32_t>(p + 4, 36 + dataBytes);
+    std::memcpy(p, "WAVEfmt ", 8);
+    p = put<uint32_t>(p + 8, 16);
+    p = put<uint16_t>(p, 3); // IEEE float
+    p = put<uint16_t>(p, static_cast<uint16_t>(channels));
+    p = put<uint32_t>(p, static_cast<uint32_t>(rate));
+    p = put<uint32_t>(p, static_cast<uint32_t>(rate) * frameBytes);
+    p = put<uint16_t>(p, static_cast<uint16_t>(frameBytes));
+    p = put<uint16_t>(p, 32);
+    std::memcpy(p, "data", 4);
+    put<uint32_t>(p + 4, dataBytes);
+
+    return std::fwrite(header, 1, HeaderBytes, file) == HeaderBytes;
+}
+
+bool TrajectoryWriter::write(const float *frame)
+{
+    if (file == nullptr || failed)
+        return false;
+
+    if ((frames + 1) * channels * sizeof(float) > MaxDataBytes)
+        return false;
+
+    if (std::fwrite(frame, sizeof(float), channels, file) != static_cast<size_t>(channels))
+    {
+        failed = true;
+        return false;
+    }
+
+    frames++;
+    return true;
+}
+
+bool TrajectoryWriter::close()
+{
+    if (file == nullptr)
+        return false;
+
+    bool ok = !failed && std::fseek(file, 0, SEEK_SET) == 0 && writeHeader();
+    ok = std::fclose(file) == 0 && ok;
+
+    file = nullptr;
+    return ok;
+}
@@ -0,0 +1,44 @@
+// TrajectoryWriter.h – Offline renders of a simulation as a multichannel WAV file
+// Every written frame is one sample frame of 32 bit float channels, e.g. x y of every body, so a
+// render opens directly in [soundfiler], an audio editor or numpy. Writes go through a large stdio
+// buffer and the header sizes are patched on close().
+
+#ifndef TRAJECTORYWRITER_H
+#define TRAJECTORYWRITER_H
+
+#include <cstdio>
+#include <cstdint>
+
+class TrajectoryWriter
+{
+public:
+    static const int HeaderBytes = 44;                 // RIFF, fmt and data chunk headers
+    static const size_t BufferBytes = 1 << 20;         // stdio buffer of the file
+    static const uint64_t MaxDataBytes = 0xFFFFFFFFull - HeaderBytes; // RIFF sizes are 32 bit
+    static const int MaxChannels = 0xFFFF / sizeof(float);             // The frame bytes are a 16 bit block align
+
+    TrajectoryWriter();
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    bool open(const char *path, int channels, int rate); // Creates the file, false on failure or beyond MaxChannels
+    bool write(const float *frame);                      // Appends one frame of channels values, false when full or on error
+    bool close();                                        // Completes the header, false if anything failed
+
+    bool isOpen() const { return file != nullptr; }
+    int getChannels() const { return channels; }
+    uint64_t getFrames() const { return frames; }
+
+private:
+    bool writeHeader(); // Header for the frames written so far
+
+    FILE *file;      // Output, nullptr while closed
+    int channels;    // Values per frame
+    int rate;        // Sample rate in the header
+    uint64_t frames; // Frames written
+    bool failed;     // A write failed
+};
+
+#endif // TRAJECTORYWRITER_H
@@ -0,0 +1,122 @@
+// WorkerPool.cpp – Persistent helper threads for splitting one simulation step across cores
+
+#include "WorkerPool.h"
+#include "CpuRelax.h"
+#include "Platform.h"
+
+WorkerPool::WorkerPool()
+    : generation(0), pending(0), stopping(false), task(nullptr), context(nullptr), threads(1)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+// Joins all helpers
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &t : helpers)
+    {
+        if (t.joinable())
+            t.join();
+    }
+
+    helpers.clear();
+    stopping = false;
+    threads = 1;
+}
+
+// Sets the number of participating threads including the caller.
+// Only call from the thread that also calls run().
+void WorkerPool::resize(int count)
+{
+    if (count < 1)
+        count = 1;
+    if (count > MaxThreads)
+        count = MaxThreads;
+
+    if (count == threads)
+        return;
+
+    stop();
+
+    // Helpers may start after the first job was posted, so they get the current generation from here.
+    // They run at the priority of the caller, which Windows does not pass on to new threads.
+    threads = count;
+    unsigned current = generation.load(std::memory_order_relaxed);
+    int priority = getCurrentThreadRealtime();
+    for (int w = 1; w < threads; ++w)
+        helpers.emplace_back(&WorkerPool::helperLoop, this, w, current, priority);
+}
+
+// Runs task on every worker and returns when all are done
+void WorkerPool::run(Task t, void *ctx)
+{
+    if (threads == 1)
+    {
+        t(ctx, 0, 1);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = t;
+        context = ctx;
+        pending.store(threads - 1, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_all();
+
+    // The calling thread takes the first share
+    t(ctx, 0, threads);
+
+    int spins = 0;
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        if (++spins < SpinCount)
+            cpuRelax();
+        else
+            std::this_thread::yield();
+    }
+}
+
+// Waits for jobs newer than seen and executes them
+void WorkerPool::helperLoop(int worker, unsigned seen, int priority)
+{
+    if (priority > 0)
+        setCurrentThreadRealtime(priority);
+
+    while (true)
+    {
+        int spins = 0;
+
+        while (generation.load(std::memory_order_acquire) == seen && !stopping.load(std::memory_order_acquire))
+        {
+            if (++spins < SpinCount)
+            {
+                cpuRelax();
+                continue;
+            }
+
+            // Nothing to do for a while: sleep until the next job
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]
+                      { return generation.load(std::memory_order_acquire) != seen || stopping.load(std::memory_order_acquire); });
+        }
+
+        if (stopping.load(std::memory_order_acquire))
+            return;
+
+        seen = generation.load(std::memory_order_acquire);
+        task(context, worker, threads);
+        pending.fetch_sub(1, std::memory_order_release);
+    }
+}
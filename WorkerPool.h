@@ -0,0 +1,76 @@
+// WorkerPool.h – Persistent helper threads for splitting one simulation step across cores
+// Helpers are started once and wait between jobs (short spin, then sleep), so a step
+// never creates or joins threads
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+class WorkerPool
+{
+public:
+    // Executes the share of one worker, worker 0 is the calling thread
+    typedef void (*Task)(void *context, int worker, int workers);
+
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    static const int MaxThreads = 64;   // Upper bound for the thread count
+    static const int SpinCount = 4000; // Polls before a waiting thread goes to sleep
+
+    void resize(int threads);                    // Sets the number of participating threads including the caller
+    int size() const { return threads; }         // Number of participating threads
+    void run(Task task, void *context);          // Runs task on every worker and returns when all are done (barrier)
+
+    // Calls f(worker, workers) once on every worker
+    template <class F>
+    void forEachWorker(F &f)
+    {
+        run(&call<F>, &f);
+    }
+
+    // Splits [0, count) into one contiguous range per worker and calls f(begin, end)
+    template <class F>
+    void parallelFor(int count, F &f)
+    {
+        auto range = [&](int worker, int workers)
+        {
+            int begin = static_cast<int>(static_cast<long long>(count) * worker / workers);
+            int end = static_cast<int>(static_cast<long long>(count) * (worker + 1) / workers);
+            if (begin < end)
+                f(begin, end);
+        };
+
+        forEachWorker(range);
+    }
+
+private:
+    template <class F>
+    static void call(void *context, int worker, int workers)
+    {
+        (*static_cast<F *>(context))(worker, workers);
+    }
+
+    void helperLoop(int worker, unsigned seen, int priority); // Waits for jobs newer than seen and executes them
+    void stop();                                // Joins all helpers
+
+    std::vector<std::thread> helpers;    // Helper threads, worker 1..threads-1
+    std::atomic<unsigned> generation;    // Incremented for every job
+    std::atomic<int> pending;            // Helpers still working on the current job
+    std::atomic<bool> stopping;          // Helpers have to exit
+    std::mutex mutex;                    // Guards sleeping helpers
+    std::condition_variable wake;        // Wakes sleeping helpers
+    Task task;                           // Current job
+    void *context;                       // Current job data
+    int threads;                         // Participating threads including the caller
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,282 @@
+// bench.cpp – Standalone timing of the simulation core, no Pure Data needed
+// make bench && build/bench [steps] [threads] > result.json
+// make bench MATH_INLINE=0 -B builds it with out of line math helpers to compare against.
+// Runs every preset at several body counts, speeds and engines and prints one JSON document.
+// The ensemble section compares K voices in one GravityEnsemble with K separate systems.
+// The integrators section follows one undamped planetary system with every integrator and reports
+// the position error against a tight RK45 reference and the force evaluations it took (meaningful
+// in double precision, float rounding alone exceeds the errors of the higher order integrators).
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "Gravity.h"
+#include "GravityEnsemble.h"
+#include "Precision.h"
+
+static const int WarmupSteps = 3;                                     // Untimed steps before each run
+static const int BodyCounts[] = {0, 256, 2048};                       // 0 is the body count of the preset
+static const double Speeds[] = {0.5, 1.0, 2.0};                       // Factors on the dt of the preset
+static const char *const Engines[] = {"direct", "symmetric", "tree"}; // Force engines to compare
+static const int Voices[] = {8, 16, 32, 64};                          // Ensemble sizes to compare
+static const double IntegratorTime = 64.0;                            // Simulated time of every integrator run
+static const double IntegratorDts[] = {0.1, 0.05, 0.025, 0.0125};     // dt of the integrator runs
+
+#if defined(__x86_64__) || defined(_M_X64)
+static const char *const Arch = "x86_64";
+#elif defined(__aarch64__)
+static const char *const Arch = "aarch64";
+#elif defined(__arm__)
+static const char *const Arch = "armv7";
+#else
+static const char *const Arch = "unknown";
+#endif
+
+// make bench MATH_INLINE=0 builds the same bench with the math helpers out of line for comparison
+#if defined(GRAV_MATH_OUTLINE)
+static const char *const MathHelpers = "outline";
+#else
+static const char *const MathHelpers = "inline";
+#endif
+
+// Adds bodies on a disc until count bodies are active, seeded so every run is identical
+static void scatter(Gravity<Real> &system, int count)
+{
+    int first = system.getBodyCount();
+    std::srand(1);
+    system.setBodyCount(count);
+
+    for (int i = first; i < count; ++i)
+    {
+        double x = std::rand() % 4000 / 10.0 - 200.0;
+        double y = std::rand() % 4000 / 10.0 - 200.0;
+        system.setBody(i, x, y, -y * 0.002, x * 0.002, 0.5 + std::rand() % 100 * 0.01);
+    }
+}
+
+// Prints one phase as nanoseconds per step
+static void printPhase(const char *name, uint64_t ns, uint64_t steps, bool last)
+{
+    std::printf("\"%s\": %.1f%s", name, static_cast<double>(ns) / steps, last ? "" : ", ");
+}
+
+// Times one configuration and prints it as a JSON object
+static void run(int preset, int count, double speed, const char *engine, int steps, int threads, bool first)
+{
+    Gravity<Real> system(count > 0 ? count : Gravity<Real>::DefaultMaxBodies);
+    system.setSeed(1);
+    system.setThreads(threads);
+    system.loadPreset(preset);
+    system.setEngine(engine);
+    system.setDt(system.getDt() * speed);
+
+    if (count > system.getBodyCount())
+        scatter(system, count);
+
+    // Large systems get fewer steps so every configuration costs about the same
+    int bodies = system.getBodyCount();
+    int runSteps = bodies > Gravity<Real>::PresetBodyCount ? std::max(5, steps * Gravity<Real>::PresetBodyCount / bodies) : steps;
+
+    for (int s = 0; s < WarmupSteps; ++s)
+        system.simulate();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int s = 0; s < runSteps; ++s)
+        system.simulate();
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    double perStep = elapsed.count() / runSteps;
+
+    // Phases are timed in a second pass, so the clock reads do not count towards ns_per_step
+    system.setProfiling(true);
+
+    for (int s = 0; s < runSteps; ++s)
+        system.simulate();
+
+    const StepProfile &p = system.getProfile();
+
+    std::printf("%s    {\"preset\": %d, \"bodies\": %d, \"engine\": \"%s\", \"speed\": %.2f, \"dt\": %.5f, \"steps\": %d, ",
+                first ? "" : ",\n", preset, bodies, engine, speed, static_cast<double>(system.getDt()), runSteps);
+    std::printf("\"ns_per_step\": %.1f, \"steps_per_sec\": %.1f, \"phase_ns_per_step\": {", perStep, 1e9 / perStep);
+    printPhase("position", p.position, p.steps, false);
+    printPhase("grid", p.grid, p.steps, false);
+    printPhase("events", p.events, p.steps, false);
+    printPhase("force", p.force, p.steps, false);
+    printPhase("repulsion", p.repulsion, p.steps, false);
+    printPhase("velocity", p.velocity, p.steps, false);
+    printPhase("adaptive_dt", p.adaptiveDt, p.steps, true);
+    std::printf("}}");
+}
+
+// Times one preset as an ensemble of voices and as the same number of separate systems
+static void runEnsemble(int preset, int voices, int steps, bool first)
+{
+    Gravity<Real> base;
+    base.setSeed(1);
+    base.loadPreset(preset);
+
+    GravityEnsemble<Real> ensemble(voices, base.getMaxBodies());
+    ensemble.load(base, 0.01);
+
+    std::vector<Gravity<Real> *> separate;
+    for (int v = 0; v < voices; ++v)
+    {
+        separate.push_back(new Gravity<Real>());
+        separate.back()->setSeed(1 + v);
+        separate.back()->loadPreset(preset);
+    }
+
+    for (int s = 0; s < WarmupSteps; ++s)
+        ensemble.simulate(base);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s)
+        ensemble.simulate(base);
+    std::chrono::duration<double, std::nano> lockstep = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s)
+    {
+        for (Gravity<Real> *system : separate)
+            system->simulate();
+    }
+    std::chrono::duration<double, std::nano> each = std::chrono::steady_clock::now() - start;
+
+    for (Gravity<Real> *system : separate)
+        delete system;
+
+    std::printf("%s    {\"preset\": %d, \"bodies\": %d, \"voices\": %d, \"steps\": %d, ",
+                first ? "" : ",\n", preset, base.getBodyCount(), voices, steps);
+    std::printf("\"ensemble_ns_per_step\": %.1f, \"separate_ns_per_step\": %.1f, \"speedup\": %.2f}",
+                lockstep.count() / steps, each.count() / steps, each.count() / lockstep.count());
+}
+
+// Five planets around a heavy centre, no damping and no speed limits in reach, so only the
+// integrator changes the trajectory. The bodies stay far enough apart for the adaptive dt to be
+// a constant 1.6 dt, so a whole number of steps lands every run on the same time.
+static void planets(Gravity<Real> &system, const char *integrator, double dt, double tolerance)
+{
+    system.setSeed(1);
+    system.setG(1);
+    system.setDt(dt);
+    system.setSoftening(0);
+    system.setPosDamping(0);
+    system.setVelDamping(0);
+    system.setVmin(0.1);
+    system.setVmax(10000);
+    system.setBlackHole(0, 0, 0);
+    system.setIntegrator(integrator);
+    system.setTolerance(tolerance);
+    system.setBodyCount(6);
+
+    // The whole system drifts faster than any orbital speed, so no body ever slows down to vmin
+    const double drift = 2;
+    system.setBody(0, 0, 0, drift, 0, 30);
+    system.setBody(1, 16, 0, drift, 1.3, 0.5);
+    system.setBody(2, 0, 34, drift - 0.9, 0, 0.5);
+    system.setBody(3, -52, 0, drift, -0.8, 1);
+    system.setBody(4, 0, -70, drift + 0.62, 0, 0.5);
+    system.setBody(5, 60, 60, drift - 0.35, 0.35, 0.5);
+}
+
+// Runs the planets for IntegratorTime and prints the error against ref (null for the reference itself)
+static void runIntegrator(const char *integrator, double dt, double tolerance, const Gravity<Real> *ref,
+                          Gravity<Real> &system, bool first)
+{
+    planets(system, integrator, dt, tolerance);
+
+    int steps = static_cast<int>(std::lround(IntegratorTime / (1.6 * dt)));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s)
+        system.simulate();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (ref == nullptr)
+        return;
+
+    double error = 0;
+    for (int i = 0; i < system.getBodyCount(); ++i)
+    {
+        Body<Real> a = system.getBody(i);
+        Body<Real> b = ref->getBody(i);
+        error = std::max(error, std::hypot(static_cast<double>(a.x - b.x), static_cast<double>(a.y - b.y)));
+    }
+
+    std::printf("%s    {\"integrator\": \"%s\", \"dt\": %g, \"tolerance\": %g, \"steps\": %d, \"time\": %.4f, ",
+                first ? "" : ",\n", integrator, dt, tolerance, steps, system.getTime());
+    std::printf("\"evaluations_per_body\": %.1f, \"position_error\": %.3e, \"ns_total\": %.0f}",
+                static_cast<double>(system.getForceEvaluations()) / system.getBodyCount(), error, elapsed.count());
+}
+
+int main(int argc, char **argv)
+{
+    int steps = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    int threads = (argc > 2) ? std::atoi(argv[2]) : 1;
+
+    if (steps < 1)
+        steps = 1;
+
+    if (threads < 1 || threads > WorkerPool::MaxThreads)
+        threads = 1;
+
+    Gravity<Real> probe;
+    std::printf("{\n  \"arch\": \"%s\", \"precision\": \"%s\", \"math\": \"%s\", \"simd\": \"%s\", \"threads\": %d, \"steps\": %d,\n  \"results\": [\n",
+                Arch, sizeof(Real) == sizeof(float) ? "float" : "double", MathHelpers, probe.getSimd(), threads, steps);
+
+    bool first = true;
+
+    for (int preset = 1; preset <= 14; ++preset)
+    {
+        for (int count : BodyCounts)
+        {
+            for (double speed : Speeds)
+            {
+                for (const char *engine : Engines)
+                {
+                    run(preset, count, speed, engine, steps, threads, first);
+                    first = false;
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+
+    std::printf("\n  ],\n  \"ensemble\": [\n");
+    first = true;
+
+    for (int preset : {1, 8})
+    {
+        for (int voices : Voices)
+        {
+            runEnsemble(preset, voices, std::max(10, steps / 4), first);
+            first = false;
+            std::fflush(stdout);
+        }
+    }
+
+    std::printf("\n  ],\n  \"integrators\": [\n");
+
+    Gravity<Real> reference;
+    runIntegrator("rk45", 0.1, 1e-12, nullptr, reference, true);
+
+    first = true;
+
+    for (const char *integrator : {"leapfrog", "yoshida4", "rk45", "block"})
+    {
+        for (double dt : IntegratorDts)
+        {
+            Gravity<Real> system;
+            runIntegrator(integrator, dt, Gravity<Real>::DefaultTolerance, &reference, system, first);
+            first = false;
+            std::fflush(stdout);
+        }
+    }
+
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
@@ -1,27 +1,104 @@
-// g.cpp - gravity simulation as a Pure Data External (C++) with up to 10 bodies
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+// g.cpp - gravity simulation as a Pure Data External (C++) with a configurable number of bodies
 // This file has been split into simulation and PD interface parts.
 // You are currently viewing: Pure Data wrapper implementation
 
-#ifdef _WIN32
-#include <windows.h>
-#else
 #include "grav.h"
-#endif
 
 t_class *grav_class = nullptr;
+static t_class *grav_share_class = nullptr;
 
-// Reads data from the simulation, fills a thread safe buffer and swaps ist for output
-static void fillSwap(t_grav *x)
+using stat_clock = PreciseClock;
+
+// Nanoseconds since start
+static uint64_t elapsed_ns(stat_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stat_clock::now() - start).count();
+}
+
+// Reloads the voices for a request the running thread left over, called once it is joined
+static void grav_ensemble_pending(t_grav *x)
+{
+    if (x->ensemble != nullptr && x->ensemble_reload.exchange(false) && !x->ensemble->loadBodies(*x->system))
+        x->ensemble_mismatch = true;
+}
+
+// One step of the ensemble on the running thread. The voices read the base system, so its queued
+// changes are applied first. The reload request is taken before them: the Pd thread queues the
+// change before it raises the flag, so a seen flag always finds its change applied below.
+static void grav_ensemble_step(t_grav *x)
+{
+    bool reload = x->ensemble_reload.exchange(false);
+
+    x->system->applyChanges();
+
+    if (reload && !x->ensemble->loadBodies(*x->system))
+        x->ensemble_mismatch = true;
+
+    x->ensemble->simulate(*x->system);
+}
+
+// Runs count simulation steps. The batch is timed as a whole so the clock is read twice per tick, not per step.
+static void run_steps(t_grav *x, int count)
+{
+    stat_clock::time_point start = stat_clock::now();
+
+    if (x->ensemble != nullptr)
+    {
+        for (int i = 0; i < count; ++i)
+            grav_ensemble_step(x);
+    }
+    else
+    {
+        for (int i = 0; i < count; ++i)
+            x->system->simulate();
+    }
+
+    x->stats->step.record(elapsed_ns(start) / count);
+    x->stats->steps.fetch_add(count, std::memory_order_relaxed);
+}
+
+// Publishes the current simulation state as the next frame. Only the outlets drop it when they are
+// behind, the stream, the history and the share get every frame.
+static void publishFrame(t_grav *x)
 {
-    // Fill write buffer with simulation results
-    x->buffer_write = x->system->getBodies();
-    x->hole_write = x->system->getBlackHole();
+    stat_clock::time_point start = stat_clock::now();
+    Snapshot *s = x->frames->beginWrite();
+
+    s->wall = std::chrono::duration_cast<std::chrono::nanoseconds>(stat_clock::now().time_since_epoch()).count();
 
-    // Swap write and read buffers
+    // An ensemble publishes all voices as one frame, voice major
+    if (x->ensemble != nullptr)
     {
-        std::lock_guard<std::mutex> lock(x->swap_mutex);
-        std::swap(x->buffer_read, x->buffer_write);
-        std::swap(x->hole_read, x->hole_write);
+        s->step = x->ensemble->getStep();
+        s->time = x->ensemble->getTime();
+        s->count = x->ensemble->copyBodies(s->bodies);
+    }
+    else
+    {
+        s->step = x->system->getStep();
+        s->time = x->system->getTime();
+        s->count = x->system->copyBodies(s->bodies);
+    }
+    s->hole = x->system->getBlackHole();
+    x->frames->endWrite();
+
+    x->stats->publish.record(elapsed_ns(start));
+    x->history->record(*s);
+
+    if (x->share != nullptr)
+        x->share->snapshot->write(*s);
+
+    // The slot is not reused before the next publish, the stream reads it alongside the consumer
+    // or from the spare slot of the producer
+    if (x->streamer->isOpen())
+    {
+        start = stat_clock::now();
+
+        if (x->streamer->send(*s) < 0)
+            x->stats->stream_errors.fetch_add(1, std::memory_order_relaxed);
+
+        x->stats->stream.record(elapsed_ns(start));
     }
 }
 
@@ -31,6 +108,87 @@ static float project(t_grav *x, float val)
     return val * x->expand_scale;
 }
 
+// Values per body in the batch modes for the subscribed fields
+static int batch_stride(int fields)
+{
+    return ((fields & FIELD_POS) ? 2 : 0) + ((fields & FIELD_VEL) ? 2 : 0) +
+           ((fields & FIELD_ACC) ? 2 : 0) + ((fields & FIELD_MASS) ? 1 : 0);
+}
+
+// Writes one frame as count, hole x, hole y followed by the subscribed fields of every body.
+// Bodies are not dropped by limits here so the layout stays fixed.
+template <class Put>
+static int batch_fill(t_grav *x, const Snapshot *frame, Put put)
+{
+    int n = 0;
+    put(n++, static_cast<float>(frame->count));
+    put(n++, project(x, static_cast<float>(frame->hole.x)));
+    put(n++, project(x, static_cast<float>(frame->hole.y)));
+
+    for (int i = 0; i < frame->count; ++i)
+    {
+        const Body<Real> &body = frame->bodies[i];
+
+        if (x->output_fields & FIELD_POS)
+        {
+            put(n++, project(x, static_cast<float>(body.x)));
+            put(n++, project(x, static_cast<float>(body.y)));
+        }
+        if (x->output_fields & FIELD_VEL)
+        {
+            put(n++, project(x, static_cast<float>(body.vx)));
+            put(n++, project(x, static_cast<float>(body.vy)));
+        }
+        if (x->output_fields & FIELD_ACC)
+        {
+            put(n++, project(x, static_cast<float>(body.ax)));
+            put(n++, project(x, static_cast<float>(body.ay)));
+        }
+        if (x->output_fields & FIELD_MASS)
+            put(n++, static_cast<float>(body.mass));
+    }
+
+    return n;
+}
+
+// Sends the whole frame as one flat list on outlet 2
+static void grav_out_batch(t_grav *x, const Snapshot *frame)
+{
+    t_atom *atoms = x->batch_atoms;
+    int n = batch_fill(x, frame, [atoms](int k, float v)
+                       { SETFLOAT(&atoms[k], v); });
+
+    outlet_list(x->out_pos, &s_list, n, atoms);
+}
+
+// Writes the whole frame into the batch array and bangs outlet 1
+static void grav_out_array(t_grav *x, const Snapshot *frame)
+{
+    t_garray *array = reinterpret_cast<t_garray *>(pd_findbyclass(x->batch_array, garray_class));
+    if (array == nullptr)
+        return;
+
+    int size = 0;
+    t_word *vec = nullptr;
+    int needed = 3 + frame->count * batch_stride(x->output_fields);
+
+    if (!garray_getfloatwords(array, &size, &vec))
+        return;
+
+    // Resizing allocates, so it only happens when the body count or the fields change
+    if (size != needed)
+    {
+        garray_resize_long(array, needed);
+        if (!garray_getfloatwords(array, &size, &vec) || size < needed)
+            return;
+    }
+
+    batch_fill(x, frame, [vec](int k, float v)
+               { vec[k].w_float = v; });
+
+    outlet_bang(x->out_bang);
+}
+
 // Sends data for each body and black hole
 // outlets
 // 1: bang on finished
@@ -38,14 +196,10 @@ static float project(t_grav *x, float val)
 // 3: Body Nr, Vx, Vy
 // 4: Body Nr, Ax, Ay
 // 5: Black hole
-static void grav_out(t_grav *x)
+// With an ensemble the lists of outlets 2-4 start with the voice
+static void grav_out_lists(t_grav *x, const Snapshot *frame)
 {
-    Body hole;
-    std::vector<Body> copy;
-
-    // Safe data access using try_lock to avoid blocking Pd thread
-    hole = x->hole_read;
-    copy = x->buffer_read;
+    const Body<Real> &hole = frame->hole;
 
     // outlet 5
     t_atom holelist[2];
@@ -53,9 +207,13 @@ static void grav_out(t_grav *x)
     SETFLOAT(&holelist[1], project(x, static_cast<float>(hole.y)));     // y
     outlet_list(x->out_hole, &s_list, 2, holelist); // black hole => outlet 5
 
-    for (int i = 0; i < static_cast<int>(copy.size()); ++i)
+    // Bodies per voice of an ensemble, 0 without: the voice atom is left out
+    const int per_voice = x->ensemble != nullptr ? x->ensemble->getBodyCount() : 0;
+    const int first = per_voice > 0 ? 0 : 1;
+
+    for (int i = 0; i < frame->count; ++i)
     {
-        const Body &body = copy[i];
+        const Body<Real> &body = frame->bodies[i];
 
         float bx = project(x, static_cast<float>(body.x));
         float by = project(x, static_cast<float>(body.y));
@@ -68,40 +226,184 @@ static void grav_out(t_grav *x)
             }
         }
 
+        // With an ensemble every list starts with the voice: voice body x y
+        int voice = per_voice > 0 ? i / per_voice : 0;
+        int nr = per_voice > 0 ? i % per_voice : i;
+
         // outlet 2
-        t_atom poslist[3];
-        SETFLOAT(&poslist[0], i);  // Body nr
-        SETFLOAT(&poslist[1], static_cast<float>(bx)); // X
-        SETFLOAT(&poslist[2], static_cast<float>(by)); // Y
+        t_atom poslist[4];
+        SETFLOAT(&poslist[0], voice);                  // Voice
+        SETFLOAT(&poslist[1], nr);                     // Body nr
+        SETFLOAT(&poslist[2], static_cast<float>(bx)); // X
+        SETFLOAT(&poslist[3], static_cast<float>(by)); // Y
 
         // outlet 3
-        t_atom vellist[3];
-        SETFLOAT(&vellist[0], i);                   // Body nr
-        SETFLOAT(&vellist[1], project(x, static_cast<float>(body.vx))); // Vx
-        SETFLOAT(&vellist[2], project(x, static_cast<float>(body.vy))); // Vy
+        t_atom vellist[4];
+        SETFLOAT(&vellist[0], voice);                                   // Voice
+        SETFLOAT(&vellist[1], nr);                                      // Body nr
+        SETFLOAT(&vellist[2], project(x, static_cast<float>(body.vx))); // Vx
+        SETFLOAT(&vellist[3], project(x, static_cast<float>(body.vy))); // Vy
 
         // outlet 4
-        t_atom acclist[3];
-        SETFLOAT(&acclist[0], i);                   // Body nr
-        SETFLOAT(&acclist[1], project(x, static_cast<float>(body.ax))); // Ax
-        SETFLOAT(&acclist[2], project(x, static_cast<float>(body.ay))); // Ay
-
-        outlet_list(x->out_acc, &s_list, 3, acclist); // outlet 4 accelerations
-        outlet_list(x->out_vel, &s_list, 3, vellist); // outlet 3 velocities
-        outlet_list(x->out_pos, &s_list, 3, poslist); // outlet 2 positions
+        t_atom acclist[4];
+        SETFLOAT(&acclist[0], voice);                                   // Voice
+        SETFLOAT(&acclist[1], nr);                                      // Body nr
+        SETFLOAT(&acclist[2], project(x, static_cast<float>(body.ax))); // Ax
+        SETFLOAT(&acclist[3], project(x, static_cast<float>(body.ay))); // Ay
+
+        // Only the subscribed fields are sent
+        if (x->output_fields & FIELD_ACC)
+            outlet_list(x->out_acc, &s_list, 4 - first, acclist + first); // outlet 4 accelerations
+        if (x->output_fields & FIELD_VEL)
+            outlet_list(x->out_vel, &s_list, 4 - first, vellist + first); // outlet 3 velocities
+        if (x->output_fields & FIELD_POS)
+            outlet_list(x->out_pos, &s_list, 4 - first, poslist + first); // outlet 2 positions
     }
 
     outlet_bang(x->out_bang); // outlet 1 Finished
 }
 
+// Sends one frame in the selected output mode
+static void grav_out_frame(t_grav *x, const Snapshot *frame)
+{
+    switch (x->output_mode)
+    {
+    case OUTPUT_BATCH:
+        grav_out_batch(x, frame);
+        break;
+    case OUTPUT_ARRAY:
+        grav_out_array(x, frame);
+        break;
+    default:
+        grav_out_lists(x, frame);
+        break;
+    }
+}
+
+// Name of an event on the events outlet
+static t_symbol *event_name(EventType type)
+{
+    switch (type)
+    {
+    case EventType::Encounter:
+        return gensym("encounter");
+    case EventType::Separation:
+        return gensym("separation");
+    case EventType::HoleEnter:
+        return gensym("enter");
+    default:
+        return gensym("leave");
+    }
+}
+
+// Sends the events that happened up to the simulated time of frame on outlet 8:
+// [encounter a b distance speed time offset(, [separation ...(, [enter body distance speed time offset(, [leave ...(
+// offset places the event between the previous and this frame in milliseconds of their publish times,
+// delaying each event by its offset reproduces the spacing of the physics steps.
+static void grav_out_events(t_grav *x, const Snapshot *frame)
+{
+    EventQueue &queue = x->system->getEvents();
+    double span = frame->time - x->event_time;
+    double wall_ms = x->event_wall != 0 ? static_cast<double>(frame->wall - x->event_wall) / 1e6 : 0.0;
+    t_atom atoms[6];
+
+    // Events of steps after this frame wait for the next one
+    for (const SimEvent *e = queue.peek(); e != nullptr && e->time <= frame->time; e = queue.peek())
+    {
+        double phase = span > 0.0 ? (e->time - x->event_time) / span : 1.0;
+        double offset = std::max(0.0, std::min(1.0, phase)) * wall_ms;
+        float values[] = {static_cast<float>(e->a), static_cast<float>(e->b), e->distance, e->speed,
+                          static_cast<float>(e->time), static_cast<float>(offset)};
+
+        // Black hole events have no second body
+        int skip = e->b >= 0 ? -1 : 1;
+        int n = 0;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            if (i != skip)
+            {
+                SETFLOAT(&atoms[n], values[i]);
+                n++;
+            }
+        }
+
+        t_symbol *name = event_name(e->type);
+        queue.pop();
+        outlet_anything(x->out_events, name, n, atoms);
+    }
+
+    x->event_time = frame->time;
+    x->event_wall = frame->wall;
+}
+
+// Outputs the newest frame, or with interpolation the state between the last two frames
+static void grav_out(t_grav *x)
+{
+    stat_clock::time_point start = stat_clock::now();
+    const Snapshot *frame = x->frames->latest();
+
+    if (frame != nullptr)
+    {
+        // Gaps in the frame numbers are frames the simulation dropped or the output skipped
+        if (x->last_frame != 0 && frame->frame > x->last_frame + 1)
+            x->frames_dropped += frame->frame - x->last_frame - 1;
+        x->last_frame = frame->frame;
+
+        // Rightmost outlet first, the events of a frame arrive before its bodies
+        grav_out_events(x, frame);
+    }
+
+    // The thread delivery and bang output right after publishing, there is nothing to interpolate
+    if (x->interp_mode != Interpolation::Off && !x->deliver_thread && x->running_thread.load())
+    {
+        if (frame != nullptr)
+        {
+            x->interp->push(*frame);
+            x->frames->release();
+        }
+
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+        frame = x->interp->sample(now, x->interp_mode);
+        if (frame == nullptr)
+            return;
+
+        grav_out_frame(x, frame);
+    }
+    else
+    {
+        if (frame == nullptr)
+            return;
+
+        grav_out_frame(x, frame);
+        x->frames->release();
+    }
+
+    x->stats->output.record(elapsed_ns(start));
+}
+
+// Name of an interpolation mode as used by the interp message
+static const char *interp_name(Interpolation mode)
+{
+    switch (mode)
+    {
+    case Interpolation::Linear:
+        return "linear";
+    case Interpolation::Hermite:
+        return "hermite";
+    default:
+        return "off";
+    }
+}
+
 // Output of body initialization values on outlet 4
 void grav_outinit(t_grav *x)
 {
     t_atom output[6];
 
-    for (int i = 0; i < x->system->BodyCount; ++i)
+    for (int i = 0; i < x->system->getBodyCount(); ++i)
     {
-        const Body &b = x->system->getInitBody(i);
+        Body<Real> b = x->system->getInitBody(i);
 
         SETFLOAT(&output[0], i); // Numeric body index
         SETFLOAT(&output[1], static_cast<float>(b.x));
@@ -164,7 +466,79 @@ void grav_outparams(t_grav *x)
     SETFLOAT(&output, x->limits ? 1 : 0);
     outlet_anything(x->out_params, gensym("limits"), 1, &output);
 
-    Body blackHole = x->system->getBlackHole();
+    // Force kernel
+    SETSYMBOL(&output, gensym(x->system->getSimd()));
+    outlet_anything(x->out_params, gensym("simd"), 1, &output);
+
+    // Force engine
+    SETSYMBOL(&output, gensym(x->system->getEngine()));
+    outlet_anything(x->out_params, gensym("engine"), 1, &output);
+
+    // Integrator and the RK45 tolerance
+    SETSYMBOL(&output, gensym(x->system->getIntegrator()));
+    outlet_anything(x->out_params, gensym("integrator"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(x->system->getTolerance()));
+    outlet_anything(x->out_params, gensym("tolerance"), 1, &output);
+
+    // Barnes–Hut opening angle
+    SETFLOAT(&output, static_cast<float>(x->system->getTheta()));
+    outlet_anything(x->out_params, gensym("theta"), 1, &output);
+
+    // Threads per simulation step
+    SETFLOAT(&output, static_cast<float>(x->system->getThreads()));
+    outlet_anything(x->out_params, gensym("threads"), 1, &output);
+
+    // Random seed
+    SETFLOAT(&output, static_cast<float>(x->system->getSeed()));
+    outlet_anything(x->out_params, gensym("seed"), 1, &output);
+
+    // Output delivery
+    SETFLOAT(&output, x->outrate_ms);
+    outlet_anything(x->out_params, gensym("outrate"), 1, &output);
+    SETSYMBOL(&output, gensym(x->deliver_thread ? "thread" : "clock"));
+    outlet_anything(x->out_params, gensym("delivery"), 1, &output);
+
+    // Fixed physics rate and output interpolation
+    SETFLOAT(&output, x->physics_hz);
+    outlet_anything(x->out_params, gensym("physics"), 1, &output);
+    SETSYMBOL(&output, gensym(interp_name(x->interp_mode)));
+    outlet_anything(x->out_params, gensym("interp"), 1, &output);
+
+    // Scheduler of the simulation thread
+    SETSYMBOL(&output, gensym(x->scheduler->getPolicy() == TickPolicy::Drop ? "drop" : "catchup"));
+    outlet_anything(x->out_params, gensym("policy"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(x->scheduler->getSpin()));
+    outlet_anything(x->out_params, gensym("spin"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(x->rt_priority));
+    outlet_anything(x->out_params, gensym("priority"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(x->cpu_affinity));
+    outlet_anything(x->out_params, gensym("affinity"), 1, &output);
+
+    // Ensemble voices and their variation
+    t_atom ensemble[2];
+    SETFLOAT(&ensemble[0], static_cast<float>(x->ensemble != nullptr ? x->ensemble->getVoices() : 0));
+    SETFLOAT(&ensemble[1], x->ensemble_spread);
+    outlet_anything(x->out_params, gensym("ensemble"), 2, ensemble);
+
+    // Clock of the simulation and workers of the shared clock
+    t_atom clock[2];
+    SETSYMBOL(&clock[0], gensym(x->shared_clock ? "shared" : "own"));
+    SETFLOAT(&clock[1], static_cast<float>(SharedScheduler::instance().getThreads()));
+    outlet_anything(x->out_params, gensym("scheduler"), 2, clock);
+
+    // Binary stream target
+    t_atom target[2];
+    SETSYMBOL(&target[0], x->stream_host == &s_ ? gensym("off") : x->stream_host);
+    SETFLOAT(&target[1], static_cast<float>(x->stream_port));
+    outlet_anything(x->out_params, gensym("stream"), 2, target);
+
+    // Event radii
+    t_atom radii[2];
+    SETFLOAT(&radii[0], static_cast<float>(x->system->getEncounterRadius()));
+    SETFLOAT(&radii[1], static_cast<float>(x->system->getHoleRadius()));
+    outlet_anything(x->out_params, gensym("events"), 2, radii);
+
+    Body<Real> blackHole = x->system->getBlackHole();
     t_atom args[3]; // x, y, m
     SETFLOAT(&args[0], static_cast<float>(blackHole.x));
     SETFLOAT(&args[1], static_cast<float>(blackHole.y));
@@ -172,12 +546,146 @@ void grav_outparams(t_grav *x)
     outlet_anything(x->out_params, gensym("hole"), 3, args);
 }
 
+// Sends one timing statistic in microseconds: <name>_min, _mean, _p99, _max
+static void grav_outtiming(t_grav *x, const char *name, const TimingStat &stat)
+{
+    const char *suffix[] = {"min", "mean", "p99", "max"};
+    double value[] = {static_cast<double>(stat.minimum()), stat.mean(),
+                      static_cast<double>(stat.percentile(0.99)), static_cast<double>(stat.maximum())};
+    char selector[64];
+    t_atom output;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        snprintf(selector, sizeof(selector), "%s_%s", name, suffix[i]);
+        SETFLOAT(&output, static_cast<float>(value[i] / 1000.0));
+        outlet_anything(x->out_params, gensym(selector), 1, &output);
+    }
+}
+
+// Reports the runtime counters on the params outlet, [stats reset( clears them
+void grav_stats(t_grav *x, t_symbol *s)
+{
+    GravStats *stats = x->stats;
+
+    if (s == gensym("reset"))
+    {
+        stats->step.reset();
+        stats->publish.reset();
+        stats->output.reset();
+        stats->stream.reset();
+        stats->steps = 0;
+        stats->overruns = 0;
+        stats->skipped = 0;
+        stats->stream_errors = 0;
+        x->system->getEvents().resetDropped();
+        SharedScheduler::instance().resetStats();
+        x->frames_dropped = 0;
+        return;
+    }
+
+    if (s != &s_)
+    {
+        pd_error(x, "[grav] unknown stats argument '%s': expecting reset", s->s_name);
+        return;
+    }
+
+    t_atom output;
+
+    SETFLOAT(&output, static_cast<float>(stats->steps.load(std::memory_order_relaxed)));
+    outlet_anything(x->out_params, gensym("steps"), 1, &output);
+
+    // Step times in microseconds
+    grav_outtiming(x, "step", stats->step);
+
+    // Ticks that finished after their deadline
+    SETFLOAT(&output, static_cast<float>(stats->overruns.load(std::memory_order_relaxed)));
+    outlet_anything(x->out_params, gensym("overruns"), 1, &output);
+
+    // Ticks the drop policy or the catch-up limit skipped
+    SETFLOAT(&output, static_cast<float>(stats->skipped.load(std::memory_order_relaxed)));
+    outlet_anything(x->out_params, gensym("skipped"), 1, &output);
+
+    // Frames that were never output
+    SETFLOAT(&output, static_cast<float>(x->frames_dropped));
+    outlet_anything(x->out_params, gensym("dropped"), 1, &output);
+
+    // Scheduling the simulation thread actually got
+    SETFLOAT(&output, static_cast<float>(stats->realtime.load()));
+    outlet_anything(x->out_params, gensym("realtime"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(stats->affinity.load()));
+    outlet_anything(x->out_params, gensym("affinity"), 1, &output);
+
+    // Publishing and output times in microseconds
+    grav_outtiming(x, "publish", stats->publish);
+    grav_outtiming(x, "out", stats->output);
+
+    // Binary stream: send times in microseconds and frames the socket refused
+    grav_outtiming(x, "stream", stats->stream);
+    SETFLOAT(&output, static_cast<float>(stats->stream_errors.load(std::memory_order_relaxed)));
+    outlet_anything(x->out_params, gensym("stream_errors"), 1, &output);
+
+    // Events lost because the output fell behind
+    SETFLOAT(&output, static_cast<float>(x->system->getEvents().getDropped()));
+    outlet_anything(x->out_params, gensym("events_dropped"), 1, &output);
+
+    // Parameter changes lost because more arrived between two steps than the queue holds
+    SETFLOAT(&output, static_cast<float>(x->system->getChangesDropped()));
+    outlet_anything(x->out_params, gensym("changes_dropped"), 1, &output);
+
+    // The common clock of all shared instances
+    SharedScheduler &shared = SharedScheduler::instance();
+    SETFLOAT(&output, static_cast<float>(shared.getActive()));
+    outlet_anything(x->out_params, gensym("shared_active"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(shared.getOverruns()));
+    outlet_anything(x->out_params, gensym("shared_overruns"), 1, &output);
+    SETFLOAT(&output, static_cast<float>(shared.getSkipped()));
+    outlet_anything(x->out_params, gensym("shared_skipped"), 1, &output);
+}
+
+// Reports a reload of the running thread that did not fit
+static void grav_ensemble_check(t_grav *x)
+{
+    if (x->ensemble != nullptr && x->ensemble_mismatch.exchange(false))
+    {
+        pd_error(x, "[grav] %d voices of %d bodies exceed the %d bodies of this [grav], the ensemble keeps its bodies",
+                 x->ensemble->getVoices(), x->system->getBodyCount(), x->system->getMaxBodies());
+    }
+}
+
+// A render owns the system until its thread is joined, also after [render stop( cleared render_active
+static bool grav_rendering(t_grav *x)
+{
+    return x->render_active.load() || x->render_worker.joinable();
+}
+
+// Restarts the voices of an ensemble from the current initial bodies of the system. While running
+// the change of the system is still queued, so the running thread reloads after applying it.
+static void grav_ensemble_reload(t_grav *x)
+{
+    if (x->ensemble == nullptr)
+        return;
+
+    if (x->running_thread.load() || grav_rendering(x))
+    {
+        x->ensemble_reload = true;
+        return;
+    }
+
+    x->ensemble_mismatch = !x->ensemble->loadBodies(*x->system);
+    grav_ensemble_check(x);
+}
+
 // Bang message: triggers one simulation step and sends output
 void grav_bang(t_grav *x)
 {
-    x->system->simulate();
+    // While running, the simulation thread owns the system and the producer side of the ring
+    if (x->running_thread.load() || grav_rendering(x))
+        return;
 
-    fillSwap(x);
+    run_steps(x, 1);
+
+    publishFrame(x);
 
     grav_out(x);
 }
@@ -204,6 +712,7 @@ void grav_scale(t_grav *x, t_floatarg val)
     }
 
     x->expand_scale = val;
+    x->streamer->setScale(val);
 }
 
 // Limits -100 100 on/off
@@ -232,9 +741,138 @@ void grav_veldamp(t_grav *x, t_floatarg val) { x->system->setVelDamping(val); }
 void grav_softening(t_grav *x, t_floatarg val) { x->system->setSoftening(val); }
 void grav_vmin(t_grav *x, t_floatarg val) { x->system->setVmin(val); }
 void grav_vmax(t_grav *x, t_floatarg val) { x->system->setVmax(val); }
-void grav_preset(t_grav *x, t_floatarg val) { x->system->loadPreset(static_cast<int>(val)); }
-void grav_reset(t_grav *x, t_floatarg) { x->system->reset(); }
-void grav_count(t_grav *x, t_floatarg val) { x->system->setBodyCount(static_cast<int>(val)); }
+void grav_preset(t_grav *x, t_floatarg val)
+{
+    x->system->loadPreset(static_cast<int>(val));
+    grav_ensemble_reload(x);
+}
+
+void grav_reset(t_grav *x, t_floatarg)
+{
+    x->system->reset();
+    grav_ensemble_reload(x);
+}
+
+void grav_count(t_grav *x, t_floatarg val)
+{
+    x->system->setBodyCount(static_cast<int>(val));
+    grav_ensemble_reload(x);
+}
+void grav_simd(t_grav *x, t_symbol *s) { x->system->setSimd(s->s_name); }
+
+// Restores a saved state like a preset: at once, the output starts over from the new state
+static void grav_restore(t_grav *x, const void *data, size_t size)
+{
+    if (!x->system->loadState(data, size))
+        return;
+
+    x->interp->clear();
+    grav_ensemble_reload(x);
+}
+
+// Slot of store and recall, false with an error when out of range
+static bool grav_slot(t_grav *x, t_floatarg val, int &slot)
+{
+    slot = static_cast<int>(val);
+
+    if (slot < 0 || slot >= GravStateSlots)
+    {
+        pd_error(x, "[grav] slot must be between 0 and %d, got %d", GravStateSlots - 1, slot);
+        return false;
+    }
+
+    return true;
+}
+
+// Complete current state of the system, false with an error while a thread steps it. A snapshot taken
+// beside the stepping thread would be torn, or empty after a count change between size and save.
+static bool grav_snapshot(t_grav *x, const char *what, std::vector<unsigned char> &state)
+{
+    if (x->running_thread.load() || grav_rendering(x))
+    {
+        pd_error(x, "[grav] cannot %s while the system is running or rendering", what);
+        return false;
+    }
+
+    state.resize(x->system->getStateSize());
+
+    if (x->system->saveState(state.data(), state.size()) == 0)
+    {
+        pd_error(x, "[grav] cannot %s, the state could not be written", what);
+        return false;
+    }
+
+    return true;
+}
+
+// [store <slot>( keeps the complete current state in memory
+void grav_store(t_grav *x, t_floatarg val)
+{
+    int slot;
+    if (!grav_slot(x, val, slot))
+        return;
+
+    std::vector<unsigned char> state;
+    if (!grav_snapshot(x, "store", state))
+        return;
+
+    x->state_slots[slot].swap(state);
+}
+
+// [recall <slot>( restores a stored state, no bodies are computed
+void grav_recall(t_grav *x, t_floatarg val)
+{
+    int slot;
+    if (!grav_slot(x, val, slot))
+        return;
+
+    const std::vector<unsigned char> &state = x->state_slots[slot];
+
+    if (state.empty())
+    {
+        pd_error(x, "[grav] slot %d is empty", slot);
+        return;
+    }
+
+    grav_restore(x, state.data(), state.size());
+}
+
+// [save <file>( writes the complete current state to a file next to the patch
+void grav_save(t_grav *x, t_symbol *s)
+{
+    char path[MAXPDSTRING];
+    canvas_makefilename(x->canvas, s->s_name, path, MAXPDSTRING);
+
+    std::vector<unsigned char> state;
+    if (!grav_snapshot(x, "save", state))
+        return;
+
+    if (!writeStateFile(path, state.data(), state.size()))
+        pd_error(x, "[grav] cannot write state file %s", path);
+}
+
+// [load <file>( restores a state file, read straight from its mapping
+void grav_load(t_grav *x, t_symbol *s)
+{
+    char path[MAXPDSTRING];
+    canvas_makefilename(x->canvas, s->s_name, path, MAXPDSTRING);
+
+    MappedFile file;
+
+    if (!file.open(path))
+    {
+        pd_error(x, "[grav] cannot open state file %s", path);
+        return;
+    }
+
+    grav_restore(x, file.data(), file.size());
+}
+void grav_engine(t_grav *x, t_symbol *s) { x->system->setEngine(s->s_name); }
+void grav_integrator(t_grav *x, t_symbol *s) { x->system->setIntegrator(s->s_name); }
+void grav_tolerance(t_grav *x, t_floatarg val) { x->system->setTolerance(val); }
+void grav_theta(t_grav *x, t_floatarg val) { x->system->setTheta(val); }
+void grav_threads(t_grav *x, t_floatarg val) { x->system->setThreads(static_cast<int>(val)); }
+void grav_seed(t_grav *x, t_floatarg val) { x->system->setSeed(static_cast<int>(val)); }
 
 // Prints simulation parameters and states to PD console
 void grav_dump(t_grav *x)
@@ -248,21 +886,47 @@ void grav_dump(t_grav *x)
     post("scale = %.3f", x->expand_scale);
     post("speed = %.3f", static_cast<float>(x->internal_steps) / 50.0f);
     post("limits = %.3f", static_cast<float>(x->limits == 0 ? 0 : 1));
+    post("simd = %s", x->system->getSimd());
+    post("engine = %s", x->system->getEngine());
+    post("integrator = %s (tolerance %g)", x->system->getIntegrator(), x->system->getTolerance());
+
+    int stored = 0;
+    for (int i = 0; i < GravStateSlots; ++i)
+        stored += x->state_slots[i].empty() ? 0 : 1;
+    post("slots = %d of %d stored", stored, GravStateSlots);
+    post("theta = %.3f", x->system->getTheta());
+    post("threads = %d", x->system->getThreads());
+    post("seed = %d", x->system->getSeed());
+    post("outrate = %.3f", x->outrate_ms);
+    post("delivery = %s", x->deliver_thread ? "thread" : "clock");
+    post("physics = %.3f", x->physics_hz);
+    post("interp = %s", interp_name(x->interp_mode));
+    post("policy = %s", x->scheduler->getPolicy() == TickPolicy::Drop ? "drop" : "catchup");
+    post("spin = %d", x->scheduler->getSpin());
+    post("priority = %d", x->rt_priority);
+    post("affinity = %d", x->cpu_affinity);
+    post("scheduler = %s (%d shared threads)", x->shared_clock ? "shared" : "own", SharedScheduler::instance().getThreads());
+    post("stream = %s %d", x->stream_host == &s_ ? "off" : x->stream_host->s_name, x->stream_port);
+    post("name = %s", x->share != nullptr ? x->share_name->s_name : "none");
+    post("history = %d every %d", x->history->getLength(), x->history->getEvery());
+    post("ensemble = %d voices spread %.3f", x->ensemble != nullptr ? x->ensemble->getVoices() : 0, x->ensemble_spread);
+    post("events = encounter %.3f hole %.3f", x->system->getEncounterRadius(), x->system->getHoleRadius());
+    post("batch = %s", x->output_mode == OUTPUT_BATCH ? "list" : (x->output_mode == OUTPUT_ARRAY ? x->batch_array->s_name : "off"));
 
     post("[grav] --- Initial body values ---");
-    for (int i = 0; i < x->system->BodyCount; ++i)
+    for (int i = 0; i < x->system->getBodyCount(); ++i)
     {
-        const Body &b = x->system->getInitBody(i);
+        Body<Real> b = x->system->getInitBody(i);
         post("[grav] >>> body[%d]: x:%.3f y:%.3f vx:%.3f vy:%.3f m:%.3f", i, b.x, b.y, b.vx, b.vy, b.mass);
     }
 
     post("[grav] --- Current body values ---");
-    for (int i = 0; i < x->system->BodyCount; ++i)
+    for (int i = 0; i < x->system->getBodyCount(); ++i)
     {
-        const Body &b = x->system->getBody(i);
+        Body<Real> b = x->system->getBody(i);
         post("[grav] >>> body[%d]: x:%.3f y:%.3f vx:%.3f vy:%.3f ax:%.3f ay:%.3f m:%.3f", i, b.x, b.y, b.vx, b.vy, b.ax, b.ay, b.mass);
     }
-    const Body &hole = x->system->getBlackHole();
+    const Body<Real> &hole = x->system->getBlackHole();
     post("[grav] --- Current black hole values ---");
     post("[grav] >>> x:%f y:%f mass:%f", hole.x, hole.y, hole.mass);
 }
@@ -275,8 +939,11 @@ void grav_body(t_grav *x, t_symbol *, int argc, t_atom *argv)
 
     int index = static_cast<int>(atom_getfloat(argv));
 
-    if (index < 0 || index >= 10)
+    if (index < 0 || index >= x->system->getMaxBodies())
+    {
+        pd_error(x, "[grav] body index must be between 0 and %d, got %d", x->system->getMaxBodies() - 1, index);
         return;
+    }
 
     float px = atom_getfloat(argv + 1);
     float py = atom_getfloat(argv + 2);
@@ -296,8 +963,11 @@ void grav_mass(t_grav *x, t_symbol *, int argc, t_atom *argv)
     int index = static_cast<int>(atom_getfloat(argv));
     float mass = atom_getfloat(argv + 1);
 
-    if (index < 0 || index >= 10)
+    if (index < 0 || index >= x->system->getMaxBodies())
+    {
+        pd_error(x, "[grav] mass index must be between 0 and %d, got %d", x->system->getMaxBodies() - 1, index);
         return;
+    }
 
     x->system->setBodyMass(index, mass);
 }
@@ -315,40 +985,80 @@ void grav_hole(t_grav *x, t_symbol *, int argc, t_atom *argv)
 }
 
 // Worker thread executes simulation
+// One tick of the simulation: the steps owed since the last tick, publishing and the thread delivery.
+// Runs on the own simulation thread or on a worker of the shared scheduler.
+static void grav_physics_tick(t_grav *x)
+{
+    if (x->physics_hz > 0.0f)
+    {
+        // Fixed physics rate: the accumulator collects the steps owed for the elapsed time,
+        // a tick may run none. Late ticks can owe at most one second of steps.
+        stat_clock::time_point now = stat_clock::now();
+        x->physics_owed += std::chrono::duration<double>(now - x->physics_last).count() * x->physics_hz;
+        x->physics_owed = std::min(x->physics_owed, static_cast<double>(x->physics_hz));
+        x->physics_last = now;
+
+        int steps = static_cast<int>(x->physics_owed);
+        x->physics_owed -= steps;
+
+        if (steps > 0)
+        {
+            run_steps(x, steps);
+            publishFrame(x);
+        }
+    }
+    else
+    {
+        run_steps(x, x->internal_steps);
+        publishFrame(x);
+    }
+
+    // In the default clock mode the Pd scheduler picks the frame up
+    if (x->deliver_thread)
+        grav_out(x);
+}
+
+// Tick function the shared scheduler calls
+static void grav_shared_tick(void *owner)
+{
+    grav_physics_tick(reinterpret_cast<t_grav *>(owner));
+}
+
 void simulate_thread(t_grav *x)
 {
-#ifndef _WIN32
-    using clock = std::chrono::steady_clock;
-    auto next_time = clock::now();
-#else
-    DWORD next_time = GetTickCount();
-#endif
+    // Priority and affinity are applied by the thread itself, the stats message shows the outcome
+    if (x->rt_priority > 0)
+        x->stats->realtime = setCurrentThreadRealtime(x->rt_priority) ? x->rt_priority : 0;
+    if (x->cpu_affinity >= 0)
+        x->stats->affinity = setCurrentThreadAffinity(x->cpu_affinity) ? x->cpu_affinity : -1;
+
+    x->scheduler->start(std::chrono::milliseconds(x->timestep_ms));
 
     while (x->running_thread.load())
     {
-        for (int i = 0; i < x->internal_steps; ++i)
-            x->system->simulate();
-
-        fillSwap(x);
+        grav_physics_tick(x);
 
-        grav_out(x);
+        // Absolute deadlines: a late tick is caught up or dropped by the policy, never shifts the rest
+        TickResult tick = x->scheduler->wait();
 
-// Calculate next tick and wait
-#ifndef _WIN32
-        next_time += std::chrono::milliseconds(static_cast<int>(x->timestep_ms));
-        while (clock::now() < next_time)
-        {
-            std::this_thread::yield();
-            std::this_thread::sleep_for(std::chrono::milliseconds(x->timestep_ms));
-        }
-#else
-        next_time += x->timestep_ms;
-        while (GetTickCount() < next_time)
-        {
-            Sleep(x->timestep_ms); // sleep a tiny bit
-        }
-#endif
+        if (tick.late)
+            x->stats->overruns.fetch_add(1, std::memory_order_relaxed);
+        if (tick.skipped > 0)
+            x->stats->skipped.fetch_add(tick.skipped, std::memory_order_relaxed);
     }
+
+    x->stats->realtime = 0;
+    x->stats->affinity = -1;
+}
+
+// Clock callback on the Pd scheduler thread: outputs the newest frame and rearms itself
+static void grav_tick(t_grav *x)
+{
+    grav_out(x);
+    grav_ensemble_check(x);
+
+    if (x->running_thread.load())
+        clock_delay(x->out_clock, x->outrate_ms);
 }
 
 // Start simulation loop
@@ -357,8 +1067,26 @@ void grav_start(t_grav *x)
     if (x->running_thread.load())
         return;
 
+    if (grav_rendering(x))
+    {
+        pd_error(x, "[grav] a render is running, [render stop( ends it");
+        return;
+    }
+
+    // From here the setters queue their changes for the simulation thread
+    x->system->setDeferred(true);
     x->running_thread = true;
-    x->worker = std::thread(simulate_thread, x);
+    x->interp->clear();
+    x->physics_last = stat_clock::now();
+    x->physics_owed = 0.0;
+
+    if (x->shared_clock)
+        SharedScheduler::instance().setActive(x, true);
+    else
+        x->worker = std::thread(simulate_thread, x);
+
+    if (!x->deliver_thread)
+        clock_delay(x->out_clock, x->outrate_ms);
 }
 
 // Stop simulation loop
@@ -367,12 +1095,664 @@ void grav_stop(t_grav *x)
     x->running_thread = false;
     if (x->worker.joinable())
         x->worker.join();
+
+    // Returns once the shared scheduler is outside the tick of this instance
+    if (x->shared_clock)
+        SharedScheduler::instance().setActive(x, false);
+
+    x->system->setDeferred(false);
+    grav_ensemble_pending(x);
+    grav_ensemble_check(x);
+    clock_unset(x->out_clock);
+}
+
+// Output interval of the clock delivery, independent of the simulation rate
+void grav_outrate(t_grav *x, t_floatarg val)
+{
+    if (val < 1.0f || val > 1000.0f)
+    {
+        pd_error(x, "[grav] outrate must be in range [1, 1000] ms, got %.3f", val);
+        return;
+    }
+
+    x->outrate_ms = val;
+}
+
+// Output mode: [batch off(, [batch list( or [batch array <name>(
+void grav_batch(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *mode = atom_getsymbolarg(0, argc, argv);
+
+    if (mode == gensym("off"))
+        x->output_mode = OUTPUT_LISTS;
+    else if (mode == gensym("list"))
+        x->output_mode = OUTPUT_BATCH;
+    else if (mode == gensym("array"))
+    {
+        t_symbol *name = atom_getsymbolarg(1, argc, argv);
+
+        if (name == &s_)
+        {
+            pd_error(x, "[grav] batch array needs an array name");
+            return;
+        }
+
+        if (pd_findbyclass(name, garray_class) == nullptr)
+            pd_error(x, "[grav] array '%s' not found yet, frames are skipped until it exists", name->s_name);
+
+        x->batch_array = name;
+        x->output_mode = OUTPUT_ARRAY;
+    }
+    else
+        pd_error(x, "[grav] unknown batch mode '%s': expecting off, list, array <name>", mode->s_name);
+}
+
+// Subscribes to the per-body fields: [fields pos vel acc mass(
+void grav_fields(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    int fields = 0;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        t_symbol *f = atom_getsymbolarg(i, argc, argv);
+
+        if (f == gensym("pos"))
+            fields |= FIELD_POS;
+        else if (f == gensym("vel"))
+            fields |= FIELD_VEL;
+        else if (f == gensym("acc"))
+            fields |= FIELD_ACC;
+        else if (f == gensym("mass"))
+            fields |= FIELD_MASS;
+        else
+        {
+            pd_error(x, "[grav] unknown field '%s': expecting pos, vel, acc, mass", f->s_name);
+            return;
+        }
+    }
+
+    x->output_fields = fields;
+    x->streamer->setFields(fields);
+}
+
+// Output interpolation between physics frames: [interp off|linear|hermite(
+void grav_interp(t_grav *x, t_symbol *s)
+{
+    if (s == gensym("off"))
+        x->interp_mode = Interpolation::Off;
+    else if (s == gensym("linear"))
+        x->interp_mode = Interpolation::Linear;
+    else if (s == gensym("hermite"))
+        x->interp_mode = Interpolation::Hermite;
+    else
+        pd_error(x, "[grav] unknown interp '%s': expecting off, linear, hermite", s->s_name);
+}
+
+// Fixed physics rate in steps per second, independent of the output rate. 0 returns to speed.
+void grav_physics(t_grav *x, t_floatarg val)
+{
+    if (val < 0.0f || val > 10000.0f)
+    {
+        pd_error(x, "[grav] physics must be in range [0, 10000] steps/s, got %.3f", val);
+        return;
+    }
+
+    x->physics_hz = val;
+}
+
+// Ticks that missed their deadline: [policy catchup( runs them back to back, [policy drop( skips them
+void grav_policy(t_grav *x, t_symbol *s)
+{
+    if (s == gensym("catchup"))
+        x->scheduler->setPolicy(TickPolicy::CatchUp);
+    else if (s == gensym("drop"))
+        x->scheduler->setPolicy(TickPolicy::Drop);
+    else
+        pd_error(x, "[grav] unknown policy '%s': expecting catchup, drop", s->s_name);
+}
+
+// Busy-wait window in microseconds before each deadline, 0 only sleeps
+void grav_spin(t_grav *x, t_floatarg val)
+{
+    if (val < 0.0f || val > TickScheduler::MaxSpinUs)
+    {
+        pd_error(x, "[grav] spin must be in range [0, %d] us, got %.3f", TickScheduler::MaxSpinUs, val);
+        return;
+    }
+
+    x->scheduler->setSpin(static_cast<int>(val));
+}
+
+// Real-time priority of the simulation thread (1-99, 0 normal), applied on the next start
+void grav_priority(t_grav *x, t_floatarg val)
+{
+    if (val < 0.0f || val > 99.0f)
+    {
+        pd_error(x, "[grav] priority must be in range [0, 99], got %.3f", val);
+        return;
+    }
+
+    x->rt_priority = static_cast<int>(val);
+}
+
+// CPU the simulation thread is pinned to (-1 none), applied on the next start
+void grav_affinity(t_grav *x, t_floatarg val)
+{
+    int cpu = static_cast<int>(val);
+    int cpus = static_cast<int>(std::thread::hardware_concurrency());
+
+    if (cpu < -1 || (cpus > 0 && cpu >= cpus))
+    {
+        pd_error(x, "[grav] affinity must be -1 or a CPU between 0 and %d, got %d", cpus - 1, cpu);
+        return;
+    }
+
+    x->cpu_affinity = cpu;
+}
+
+// Ensemble of voices stepped in lockstep, only while stopped: [ensemble <voices> [spread]( runs that many
+// copies of the current system, voices after the first vary G and the initial velocities by up to ±spread.
+// voices * bodies must fit the capacity of [grav], [ensemble 0( returns to the single system.
+void grav_ensemble(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (x->running_thread.load() || grav_rendering(x))
+    {
+        pd_error(x, "[grav] ensemble can only be changed while stopped");
+        return;
+    }
+
+    int voices = static_cast<int>(atom_getfloatarg(0, argc, argv));
+    float spread = atom_getfloatarg(1, argc, argv);
+
+    if (voices < 0 || voices > GravityEnsemble<Real>::MaxVoices)
+    {
+        pd_error(x, "[grav] ensemble voices must be between 0 and %d, got %d", GravityEnsemble<Real>::MaxVoices, voices);
+        return;
+    }
+
+    if (voices > 0 && voices * x->system->getBodyCount() > x->system->getMaxBodies())
+    {
+        pd_error(x, "[grav] %d voices of %d bodies exceed the %d bodies of this [grav], create it with [grav %d]",
+                 voices, x->system->getBodyCount(), x->system->getMaxBodies(), voices * x->system->getBodyCount());
+        return;
+    }
+
+    delete x->ensemble;
+    x->ensemble = nullptr;
+    x->ensemble_spread = 0.0f;
+
+    if (voices == 0)
+        return;
+
+    x->ensemble = new GravityEnsemble<Real>(voices, x->system->getMaxBodies() / voices);
+    x->ensemble->load(*x->system, spread);
+    x->ensemble_spread = spread;
+}
+
+// Settings of one voice: [voice <n> gscale <factor>(, [voice <n> softscale <factor>( on the G and the
+// softening of the system, [voice <n> seed <s>( for its variation: G at once, the velocities by the next
+// reset. Only while stopped.
+void grav_voice(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (x->ensemble == nullptr)
+    {
+        pd_error(x, "[grav] voice needs an ensemble, see [ensemble <voices>(");
+        return;
+    }
+
+    // The running thread reads the lane settings and generators in every step
+    if (x->running_thread.load() || grav_rendering(x))
+    {
+        pd_error(x, "[grav] voice can only be changed while stopped");
+        return;
+    }
+
+    int voice = static_cast<int>(atom_getfloatarg(0, argc, argv));
+    t_symbol *param = atom_getsymbolarg(1, argc, argv);
+    float value = atom_getfloatarg(2, argc, argv);
+
+    if (argc != 3 || voice < 0 || voice >= x->ensemble->getVoices())
+    {
+        pd_error(x, "[grav] voice expects <0-%d> gscale|softscale|seed <value>", x->ensemble->getVoices() - 1);
+        return;
+    }
+
+    if (param == gensym("gscale"))
+        x->ensemble->setGScale(voice, value);
+    else if (param == gensym("softscale"))
+        x->ensemble->setSoftScale(voice, value);
+    else if (param == gensym("seed"))
+        x->ensemble->setSeed(voice, static_cast<int>(value));
+    else
+        pd_error(x, "[grav] unknown voice parameter '%s': expecting gscale, softscale, seed", param->s_name);
+}
+
+// Clock of the simulation, only while stopped: [scheduler own( runs a thread for this instance (default),
+// [scheduler shared( steps it with all other shared instances on one clock.
+// [scheduler threads <n>( sets the workers of the shared clock for the whole process.
+void grav_scheduler(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *mode = atom_getsymbolarg(0, argc, argv);
+
+    if (mode == gensym("threads"))
+    {
+        int count = static_cast<int>(atom_getfloatarg(1, argc, argv));
+
+        if (count < 1 || count > WorkerPool::MaxThreads)
+        {
+            pd_error(x, "[grav] scheduler threads must be between 1 and %d, got %d", WorkerPool::MaxThreads, count);
+            return;
+        }
+
+        SharedScheduler::instance().setThreads(count);
+        return;
+    }
+
+    if (mode != gensym("own") && mode != gensym("shared"))
+    {
+        pd_error(x, "[grav] unknown scheduler '%s': expecting own, shared, threads", mode->s_name);
+        return;
+    }
+
+    if (x->running_thread.load())
+    {
+        pd_error(x, "[grav] scheduler can only be changed while stopped");
+        return;
+    }
+
+    x->shared_clock = mode == gensym("shared");
+}
+
+// Render thread: steps flat out, without any clock, and writes every nth frame. Values per body
+// follow the subscribed fields as in the batch modes, scaled like the outlets.
+static void render_thread(t_grav *x, uint64_t steps, int every, int fields, int bodies)
+{
+    std::vector<Body<Real>> frame(static_cast<size_t>(x->system->getMaxBodies()));
+    std::vector<float> values(static_cast<size_t>(x->render_writer->getChannels()), 0.0f);
+    const float scale = x->expand_scale;
+
+    for (uint64_t s = 1; s <= steps && x->render_active.load(std::memory_order_relaxed); ++s)
+    {
+        if (x->ensemble != nullptr)
+            grav_ensemble_step(x);
+        else
+            x->system->simulate();
+
+        if (s % static_cast<uint64_t>(every) == 0)
+        {
+            int count = x->ensemble != nullptr ? x->ensemble->copyBodies(frame.data()) : x->system->copyBodies(frame.data());
+            size_t n = 0;
+
+            // The channel layout is fixed for the file, a changed body count is cut or padded
+            for (int i = 0; i < bodies; ++i)
+            {
+                const Body<Real> body = i < count ? frame[i] : Body<Real>{};
+
+                if (fields & FIELD_POS)
+                {
+                    values[n++] = static_cast<float>(body.x) * scale;
+                    values[n++] = static_cast<float>(body.y) * scale;
+                }
+                if (fields & FIELD_VEL)
+                {
+                    values[n++] = static_cast<float>(body.vx) * scale;
+                    values[n++] = static_cast<float>(body.vy) * scale;
+                }
+                if (fields & FIELD_ACC)
+                {
+                    values[n++] = static_cast<float>(body.ax) * scale;
+                    values[n++] = static_cast<float>(body.ay) * scale;
+                }
+                if (fields & FIELD_MASS)
+                    values[n++] = static_cast<float>(body.mass);
+            }
+
+            if (!x->render_writer->write(values.data()))
+            {
+                x->render_failed = true;
+                break;
+            }
+        }
+
+        x->render_done.store(s, std::memory_order_relaxed);
+    }
+
+    if (!x->render_writer->close())
+        x->render_failed = true;
+
+    x->render_active = false;
+}
+
+// Progress of a render on the params outlet, polled on the Pd scheduler thread:
+// [render progress <done> <steps>( while it runs, then [render done <steps> <frames> <steps/s>(
+static void grav_render_tick(t_grav *x)
+{
+    t_atom out[4];
+    double done = static_cast<double>(x->render_done.load(std::memory_order_relaxed));
+
+    if (x->render_active.load())
+    {
+        SETSYMBOL(&out[0], gensym("progress"));
+        SETFLOAT(&out[1], static_cast<float>(done));
+        SETFLOAT(&out[2], static_cast<float>(x->render_steps));
+        outlet_anything(x->out_params, gensym("render"), 3, out);
+        clock_delay(x->render_clock, GravRenderProgressMs);
+        return;
+    }
+
+    if (x->render_worker.joinable())
+        x->render_worker.join();
+
+    // start is refused until the join above, so no run can have taken over the deferral
+    if (!x->running_thread.load())
+        x->system->setDeferred(false);
+    grav_ensemble_pending(x);
+    grav_ensemble_check(x);
+
+    // Nothing drained the events of the render, the next output starts without them
+    EventQueue &events = x->system->getEvents();
+    while (events.peek() != nullptr)
+        events.pop();
+    events.resetDropped();
+
+    if (x->render_failed)
+        pd_error(x, "[grav] render stopped after %.0f steps: cannot write, disk full or 4 GB reached", done);
+
+    std::chrono::duration<double> seconds = stat_clock::now() - x->render_start;
+
+    SETSYMBOL(&out[0], gensym("done"));
+    SETFLOAT(&out[1], static_cast<float>(done));
+    SETFLOAT(&out[2], static_cast<float>(x->render_writer->getFrames()));
+    SETFLOAT(&out[3], static_cast<float>(seconds.count() > 0 ? done / seconds.count() : 0.0));
+    outlet_anything(x->out_params, gensym("render"), 4, out);
+}
+
+// Offline render, only while stopped: [render <steps> <file> [every] [rate]( runs that many steps as
+// fast as the CPU allows on a background thread and writes every nth frame (default 1) as one sample
+// frame of a 32 bit float WAV file with the given sample rate (default 44100). [render stop( ends it early.
+void grav_render(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (argc > 0 && argv[0].a_type == A_SYMBOL && atom_getsymbol(argv) == gensym("stop"))
+    {
+        // Joined here, not by the progress clock, so the system is free once the message returns.
+        // The thread ends after its current step and closes the file.
+        x->render_active = false;
+        if (x->render_worker.joinable())
+            x->render_worker.join();
+        return;
+    }
+
+    if (grav_rendering(x))
+    {
+        pd_error(x, "[grav] a render is running, [render stop( ends it");
+        return;
+    }
+
+    if (x->running_thread.load())
+    {
+        pd_error(x, "[grav] render only while stopped");
+        return;
+    }
+
+    double steps = atom_getfloatarg(0, argc, argv);
+    t_symbol *file = atom_getsymbolarg(1, argc, argv);
+    int every = argc > 2 ? static_cast<int>(atom_getfloatarg(2, argc, argv)) : 1;
+    int rate = argc > 3 ? static_cast<int>(atom_getfloatarg(3, argc, argv)) : 44100;
+
+    if (steps < 1 || file == &s_)
+    {
+        pd_error(x, "[grav] render expects <steps> <file> [every] [rate]");
+        return;
+    }
+
+    if (every < 1 || rate < 1)
+    {
+        pd_error(x, "[grav] render every and rate must be >= 1, got %d %d", every, rate);
+        return;
+    }
+
+    int bodies = x->ensemble != nullptr ? x->ensemble->getVoices() * x->ensemble->getBodyCount() : x->system->getBodyCount();
+    int channels = bodies * batch_stride(x->output_fields);
+
+    if (channels > TrajectoryWriter::MaxChannels)
+    {
+        pd_error(x, "[grav] render of %d channels exceeds the %d channels of a WAV file, subscribe fewer fields",
+                 channels, TrajectoryWriter::MaxChannels);
+        return;
+    }
+
+    char path[MAXPDSTRING];
+    canvas_makefilename(x->canvas, file->s_name, path, MAXPDSTRING);
+
+    if (!x->render_writer->open(path, channels, rate))
+    {
+        pd_error(x, "[grav] cannot write render file %s (%d channels)", path, channels);
+        return;
+    }
+
+    x->render_steps = static_cast<uint64_t>(steps);
+    x->render_done = 0;
+    x->render_failed = false;
+    x->render_active = true;
+    x->render_start = stat_clock::now();
+    x->system->setDeferred(true);
+    x->render_worker = std::thread(render_thread, x, x->render_steps, every, x->output_fields, bodies);
+
+    clock_delay(x->render_clock, GravRenderProgressMs);
+}
+
+// Binary UDP stream of every published frame: [stream <host> <port>( or [stream off(
+void grav_stream(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *host = atom_getsymbolarg(0, argc, argv);
+
+    if (host == gensym("off"))
+    {
+        x->streamer->close();
+        x->stream_host = &s_;
+        x->stream_port = 0;
+        return;
+    }
+
+    int port = static_cast<int>(atom_getfloatarg(1, argc, argv));
+
+    if (host == &s_ || port < 1 || port > 65535)
+    {
+        pd_error(x, "[grav] stream expects a host and a port between 1 and 65535, or off");
+        return;
+    }
+
+    if (!x->streamer->open(host->s_name, port))
+    {
+        pd_error(x, "[grav] stream cannot reach %s:%d", host->s_name, port);
+        x->stream_host = &s_;
+        x->stream_port = 0;
+        return;
+    }
+
+    x->stream_host = host;
+    x->stream_port = port;
+}
+
+// Trails of the bodies:
+// [history size <samples>( keeps that many positions per body (0 off, only while stopped),
+// [history every <frames>( records every nth published frame,
+// [history <body> <points> [array]( writes the trail, oldest first, as x y pairs into the array
+// or sends it as [history <body> x y x y ...( on the params outlet. 0 points returns the whole trail.
+void grav_history(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *command = atom_getsymbolarg(0, argc, argv);
+
+    if (command == gensym("size"))
+    {
+        int samples = static_cast<int>(atom_getfloatarg(1, argc, argv));
+
+        // The ring is reallocated, the simulation thread must not record meanwhile
+        if (x->running_thread.load())
+        {
+            pd_error(x, "[grav] history size can only be changed while stopped");
+            return;
+        }
+
+        if (!x->history->resize(samples))
+            pd_error(x, "[grav] history size must be in range [0, %d] for %d bodies, got %d",
+                     TrailHistory::MaxPoints / x->system->getMaxBodies(), x->system->getMaxBodies(), samples);
+        return;
+    }
+
+    if (command == gensym("every"))
+    {
+        x->history->setEvery(static_cast<int>(atom_getfloatarg(1, argc, argv)));
+        return;
+    }
+
+    if (argc < 1 || argv[0].a_type != A_FLOAT)
+    {
+        pd_error(x, "[grav] history expects size <samples>, every <frames> or <body> <points> [array]");
+        return;
+    }
+
+    int body = static_cast<int>(atom_getfloatarg(0, argc, argv));
+    int points = static_cast<int>(atom_getfloatarg(1, argc, argv));
+    t_symbol *name = atom_getsymbolarg(2, argc, argv);
+
+    if (body < 0 || body >= x->system->getMaxBodies())
+    {
+        pd_error(x, "[grav] history body must be in range [0, %d], got %d", x->system->getMaxBodies() - 1, body);
+        return;
+    }
+
+    int length = x->history->getLength();
+    if (points <= 0 || points > length)
+        points = length;
+
+    if (name != &s_)
+    {
+        t_garray *array = reinterpret_cast<t_garray *>(pd_findbyclass(name, garray_class));
+        int size = 0;
+        t_word *vec = nullptr;
+
+        if (array == nullptr || !garray_getfloatwords(array, &size, &vec))
+        {
+            pd_error(x, "[grav] history array '%s' not found", name->s_name);
+            return;
+        }
+
+        // The trail is written in place first, then the array is cut to the points it got
+        if (size < points * 2)
+        {
+            garray_resize_long(array, points * 2);
+            if (!garray_getfloatwords(array, &size, &vec) || size < points * 2)
+                return;
+        }
+
+        int k = 0;
+        int n = x->history->trail(body, points, [x, vec, &k](float px, float py)
+                                  {
+                                      vec[k++].w_float = project(x, px);
+                                      vec[k++].w_float = project(x, py);
+                                  });
+
+        if (size != n * 2)
+            garray_resize_long(array, n * 2 > 0 ? n * 2 : 1);
+        garray_redraw(array);
+        return;
+    }
+
+    int capacity = 1 + points * 2;
+    t_atom *atoms = reinterpret_cast<t_atom *>(getbytes(capacity * sizeof(t_atom)));
+    int k = 1;
+
+    SETFLOAT(&atoms[0], static_cast<float>(body));
+    x->history->trail(body, points, [x, atoms, &k](float px, float py)
+                      {
+                          SETFLOAT(&atoms[k], project(x, px));
+                          SETFLOAT(&atoms[k + 1], project(x, py));
+                          k += 2;
+                      });
+
+    outlet_anything(x->out_params, gensym("history"), k, atoms);
+    freebytes(atoms, capacity * sizeof(t_atom));
+}
+
+// Event detection at every physics step, radii in simulation units:
+// [events encounter <radius>( pairs closer than radius, [events hole <radius>( bodies near the black hole,
+// a radius of 0 or [events off( disables them
+void grav_events(t_grav *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *kind = atom_getsymbolarg(0, argc, argv);
+
+    if (kind == gensym("off"))
+    {
+        x->system->setEncounterRadius(0.0);
+        x->system->setHoleRadius(0.0);
+        return;
+    }
+
+    if (argc < 2 || argv[1].a_type != A_FLOAT)
+    {
+        pd_error(x, "[grav] events expects encounter <radius>, hole <radius> or off");
+        return;
+    }
+
+    double radius = atom_getfloat(argv + 1);
+
+    if (kind == gensym("encounter"))
+        x->system->setEncounterRadius(radius);
+    else if (kind == gensym("hole"))
+        x->system->setHoleRadius(radius);
+    else
+        pd_error(x, "[grav] unknown events '%s': expecting encounter, hole, off", kind->s_name);
+}
+
+// Selects who fires the outlets: clock (Pd scheduler, default) or thread (simulation thread)
+void grav_delivery(t_grav *x, t_symbol *s)
+{
+    // Only one thread may read the snapshot ring
+    if (x->running_thread.load())
+    {
+        pd_error(x, "[grav] delivery can only be changed while stopped");
+        return;
+    }
+
+    if (s == gensym("clock"))
+        x->deliver_thread = false;
+    else if (s == gensym("thread"))
+        x->deliver_thread = true;
+    else
+        pd_error(x, "[grav] unknown delivery '%s': expecting clock, thread", s->s_name);
+}
+
+// Shares the frames under name for [gravf <mode> <name> ...], one [grav] per name
+static void grav_share(t_grav *x, t_symbol *name)
+{
+    if (name->s_thing != nullptr)
+    {
+        pd_error(x, "[grav] name '%s' is already in use, the frames are not shared", name->s_name);
+        return;
+    }
+
+    x->share = reinterpret_cast<GravShare *>(pd_new(grav_share_class));
+    x->share->snapshot = new SharedSnapshot(x->system->getMaxBodies());
+    x->share_name = name;
+    pd_bind(&x->share->pd, name);
 }
 
 // Creates new instance of the PD object
-void *grav_new()
+// Optional creation arguments: maximum number of bodies and a name for the shared frames [grav 1000 sun]
+void *grav_new(t_symbol *, int argc, t_atom *argv)
 {
     t_grav *x = reinterpret_cast<t_grav *>(pd_new(grav_class));
+    t_float maxbodies = 0;
+    t_symbol *name = &s_;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        if (argv[i].a_type == A_FLOAT)
+            maxbodies = atom_getfloat(argv + i);
+        else if (argv[i].a_type == A_SYMBOL)
+            name = atom_getsymbol(argv + i);
+    }
 
     x->out_bang = outlet_new(&x->x_obj, &s_bang);       // bang on finish
     x->out_pos = outlet_new(&x->x_obj, &s_list);        // outlet 2 for positions
@@ -381,14 +1761,67 @@ void *grav_new()
     x->out_hole = outlet_new(&x->x_obj, &s_list);       // outlet 5 for black hole
     x->out_params = outlet_new(&x->x_obj, &s_list);     // outlet 6 for current simulations parameters
     x->out_initvalues = outlet_new(&x->x_obj, &s_list); // outlet 7 for body current initialization values
+    x->out_events = outlet_new(&x->x_obj, &s_anything); // outlet 8 for encounter and black hole events
 
     x->timestep_ms = 10.0;
     x->internal_steps = 1;
+    x->physics_hz = 0.0f;
     x->expand_scale = 1;
     x->limit_max = 100;
+    x->outrate_ms = 10.0f;
+    x->deliver_thread = false;
+    x->output_mode = OUTPUT_LISTS;
+    x->output_fields = FIELD_POS | FIELD_VEL | FIELD_ACC;
+    x->batch_array = &s_;
     x->running = false;
     x->limits = false;
-    x->system = new Gravity();
+    int capacity = (maxbodies > 0) ? static_cast<int>(maxbodies) : Gravity<Real>::DefaultMaxBodies;
+
+    if (capacity < Gravity<Real>::DefaultMaxBodies || capacity > Gravity<Real>::MaxBodyLimit)
+    {
+        pd_error(x, "[grav] max bodies must be between %d and %d, got %d => clamped",
+                 Gravity<Real>::DefaultMaxBodies, Gravity<Real>::MaxBodyLimit, capacity);
+    }
+
+    x->system = new Gravity<Real>(capacity);
+    x->frames = new SnapshotRing(x->system->getMaxBodies());
+    x->batch_size = 3 + x->system->getMaxBodies() * batch_stride(FIELD_POS | FIELD_VEL | FIELD_ACC | FIELD_MASS);
+    x->batch_atoms = reinterpret_cast<t_atom *>(getbytes(x->batch_size * sizeof(t_atom)));
+    x->last_frame = 0;
+    x->frames_dropped = 0;
+    x->stats = new GravStats();
+    x->interp = new FrameInterpolator(x->system->getMaxBodies());
+    x->interp_mode = Interpolation::Off;
+    x->scheduler = new TickScheduler();
+    x->rt_priority = 0;
+    x->cpu_affinity = -1;
+    x->streamer = new FrameStreamer();
+    x->streamer->setFields(x->output_fields);
+    x->stream_host = &s_;
+    x->stream_port = 0;
+    x->history = new TrailHistory(x->system->getMaxBodies());
+    x->share = nullptr;
+    x->share_name = &s_;
+    x->event_time = 0.0;
+    x->event_wall = 0;
+    x->shared_clock = false;
+    x->ensemble = nullptr;
+    x->ensemble_spread = 0.0f;
+    x->ensemble_reload = false;
+    x->ensemble_mismatch = false;
+    x->physics_owed = 0.0;
+    x->state_slots = new std::vector<unsigned char>[GravStateSlots];
+    x->render_writer = new TrajectoryWriter();
+    x->render_active = false;
+    x->render_failed = false;
+    x->render_clock = clock_new(x, reinterpret_cast<t_method>(grav_render_tick));
+    x->canvas = canvas_getcurrent();
+    SharedScheduler::instance().add(x, grav_shared_tick);
+
+    if (name != &s_)
+        grav_share(x, name);
+
+    x->out_clock = clock_new(x, reinterpret_cast<t_method>(grav_tick));
     return x;
 }
 
@@ -400,8 +1833,43 @@ void grav_free(t_grav *x)
     if (x->worker.joinable())
         x->worker.join();
 
+    SharedScheduler::instance().remove(x);
+
+    x->render_active = false;
+    if (x->render_worker.joinable())
+        x->render_worker.join();
+    clock_free(x->render_clock);
+    delete x->render_writer;
+    x->render_writer = nullptr;
+
+    delete x->ensemble;
+    x->ensemble = nullptr;
     delete x->system;
     x->system = nullptr;
+    clock_free(x->out_clock);
+    delete x->frames;
+    x->frames = nullptr;
+    freebytes(x->batch_atoms, x->batch_size * sizeof(t_atom));
+    delete x->stats;
+    x->stats = nullptr;
+    delete x->scheduler;
+    x->scheduler = nullptr;
+    delete x->interp;
+    x->interp = nullptr;
+    delete x->streamer;
+    x->streamer = nullptr;
+    delete x->history;
+    x->history = nullptr;
+    delete[] x->state_slots;
+    x->state_slots = nullptr;
+
+    if (x->share != nullptr)
+    {
+        pd_unbind(&x->share->pd, x->share_name);
+        delete x->share->snapshot;
+        pd_free(&x->share->pd);
+        x->share = nullptr;
+    }
 }
 
 // Setup function: called when external is loaded by PD
@@ -411,7 +1879,10 @@ extern "C" void grav_setup(void)
                            reinterpret_cast<t_newmethod>(grav_new),
                            reinterpret_cast<t_method>(grav_free),
                            sizeof(t_grav),
-                           CLASS_DEFAULT, A_NULL);
+                           CLASS_DEFAULT, A_GIMME, 0);
+
+    // Bare object bound to the name of [grav <name>], found by [gravf] through the symbol
+    grav_share_class = class_new(gensym(GravShareClass), nullptr, nullptr, sizeof(GravShare), CLASS_PD, A_NULL);
 
     CLASS_MAINSIGNALIN(grav_class, t_grav, x_f);
     class_addbang(grav_class, reinterpret_cast<t_method>(grav_bang));
@@ -437,4 +1908,33 @@ extern "C" void grav_setup(void)
     class_addmethod(grav_class, reinterpret_cast<t_method>(grav_scale), gensym("scale"), A_FLOAT, 0);
     class_addmethod(grav_class, reinterpret_cast<t_method>(grav_limits), gensym("limits"), A_FLOAT, 0);
     class_addmethod(grav_class, reinterpret_cast<t_method>(grav_nudge), gensym("nudge"), A_NULL);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_simd), gensym("simd"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_engine), gensym("engine"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_integrator), gensym("integrator"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_store), gensym("store"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_recall), gensym("recall"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_save), gensym("save"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_render), gensym("render"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_load), gensym("load"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_tolerance), gensym("tolerance"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_theta), gensym("theta"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_threads), gensym("threads"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_seed), gensym("seed"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_outrate), gensym("outrate"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_delivery), gensym("delivery"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_batch), gensym("batch"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_fields), gensym("fields"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_stats), gensym("stats"), A_DEFSYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_interp), gensym("interp"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_physics), gensym("physics"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_policy), gensym("policy"), A_SYMBOL, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_spin), gensym("spin"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_priority), gensym("priority"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_affinity), gensym("affinity"), A_FLOAT, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_scheduler), gensym("scheduler"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_ensemble), gensym("ensemble"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_voice), gensym("voice"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_stream), gensym("stream"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_history), gensym("history"), A_GIMME, 0);
+    class_addmethod(grav_class, reinterpret_cast<t_method>(grav_events), gensym("events"), A_GIMME, 0);
 }
@@ -11,10 +11,58 @@ extern "C"
 
 #include <thread>
 #include <atomic>
-#include <mutex>
 #include <chrono>
 #include <vector>
+#include <cstdio>
 #include "Gravity.h"
+#include "GravityEnsemble.h"
+#include "Precision.h"
+#include "SnapshotRing.h"
+#include "FrameInterpolator.h"
+#include "FrameStreamer.h"
+#include "TrailHistory.h"
+#include "SharedSnapshot.h"
+#include "TimingStat.h"
+#include "Platform.h"
+#include "TickScheduler.h"
+#include "SharedScheduler.h"
+#include "StateFile.h"
+#include "TrajectoryWriter.h"
+
+static const int GravStateSlots = 16;       // Memory slots of store and recall
+static const int GravRenderProgressMs = 100; // Interval of the render progress messages
+
+// Output modes of grav_out
+enum GravOutput
+{
+    OUTPUT_LISTS, // One list per body and field on outlets 2-4 (default)
+    OUTPUT_BATCH, // The whole frame as one flat list on outlet 2
+    OUTPUT_ARRAY, // The whole frame written to a garray, bang on outlet 1
+};
+
+// Per-body fields a patch subscribes to with the fields message
+enum GravField
+{
+    FIELD_POS = 1,  // x y
+    FIELD_VEL = 2,  // vx vy
+    FIELD_ACC = 4,  // ax ay
+    FIELD_MASS = 8, // m, batch modes only
+};
+
+// Counters of the simulation thread and the output, reported by the stats message
+struct GravStats
+{
+    TimingStat step;                        // Duration of one simulate() call
+    TimingStat publish;                     // Duration of publishFrame
+    TimingStat output;                      // Duration of grav_out when a frame was sent
+    TimingStat stream;                      // Duration of sending one frame to the stream target
+    std::atomic<uint64_t> steps{0};         // Simulation steps executed
+    std::atomic<uint64_t> overruns{0};      // Ticks that ended after their deadline
+    std::atomic<uint64_t> skipped{0};       // Ticks dropped by the scheduler
+    std::atomic<uint64_t> stream_errors{0}; // Frames the stream socket refused
+    std::atomic<int> realtime{0};           // Real-time priority the simulation thread got, 0 for normal
+    std::atomic<int> affinity{-1};          // CPU the simulation thread is pinned to, -1 for none
+};
 
 // Internal data structure for the Pure Data object
 struct t_grav
@@ -25,10 +73,18 @@ struct t_grav
     std::chrono::steady_clock::time_point last_output; // Timestamp of the last data output to ensure output rate matches simulation timing
     int timestep_ms;                                   // Time step interval in milliseconds
     int internal_steps;                                // Simulation steps per PD tick
+    float physics_hz;                                  // Fixed physics rate in steps per second, 0 uses internal_steps per tick
     float expand_scale;                                // Scale für value ranges
     float limit_max;                                   // maximum for scaled value
+    float outrate_ms;                                  // Output interval of the clock delivery in milliseconds
+    bool deliver_thread;                               // Outlets fired from the simulation thread instead of the Pd clock
     bool running;                                      // Is simulation active?
     bool limits;                                       // Limits -100 100 on/off
+    int output_mode;                                   // GravOutput
+    int output_fields;                                 // GravField bits
+    t_symbol *batch_array;                             // Target garray of OUTPUT_ARRAY
+    t_atom *batch_atoms;                               // Preallocated list of OUTPUT_BATCH
+    int batch_size;                                    // Atoms in batch_atoms
 
     t_outlet *out_bang;       // Bang for step finished
     t_outlet *out_pos;        // Position outlet
@@ -37,16 +93,47 @@ struct t_grav
     t_outlet *out_hole;       // Black hole outlet
     t_outlet *out_params;     // Simulation paramters
     t_outlet *out_initvalues; // Body initialization values
+    t_outlet *out_events;     // Encounter and black hole events
 
     std::thread worker;               // Background thread that runs the simulation loop independently of the DSP thread
     std::atomic<bool> running_thread; // Thread control flag: true while the background simulation thread should continue running
-    std::vector<Body> buffer_read;
-    std::vector<Body> buffer_write;
-    Body hole_read;
-    Body hole_write;
-    std::mutex swap_mutex;
+    SnapshotRing *frames;             // Snapshots from the simulation thread to the output
+    t_clock *out_clock;               // Fires the outlets on the Pd scheduler thread
+    uint64_t last_frame;              // Frame number of the last output
+    uint64_t frames_dropped;          // Frames that were never output
+    FrameInterpolator *interp;        // Output frames between the physics frames
+    Interpolation interp_mode;        // Interpolation of the clock delivery
+    GravStats *stats;                 // Timing counters, always on
+    TickScheduler *scheduler;         // Deadlines of the simulation thread
+    int rt_priority;                  // Real-time priority requested for the simulation thread, 0 for normal
+    int cpu_affinity;                 // CPU requested for the simulation thread, -1 for none
+    FrameStreamer *streamer;          // Binary UDP output of every published frame
+    t_symbol *stream_host;            // Target of the stream, &s_ when off
+    int stream_port;                  // Port of the stream target
+    TrailHistory *history;            // Past positions of every body, fed by publishFrame
+    GravShare *share;                 // Frame shared under the name of [grav <name>], nullptr without a name
+    t_symbol *share_name;             // Name of the shared frame, &s_ without a name
+    double event_time;                // Simulated time of the frame that drained the events last
+    int64_t event_wall;               // Publish time of that frame, 0 before the first one
+    bool shared_clock;                // Stepped by the shared scheduler instead of an own thread
+    std::chrono::steady_clock::time_point physics_last; // Time of the last tick at a fixed physics rate
+    double physics_owed;                                // Steps owed at a fixed physics rate
 
-    Gravity *system; // Pointer to the simulation system
+    Gravity<Real> *system;           // Pointer to the simulation system
+    GravityEnsemble<Real> *ensemble; // Voices stepped instead of the system, nullptr without an ensemble
+    float ensemble_spread;           // Variation of the ensemble voices
+    std::atomic<bool> ensemble_reload;   // The running thread reloads the voices after applying the queued changes
+    std::atomic<bool> ensemble_mismatch; // That reload failed, reported on the Pd thread
+    std::vector<unsigned char> *state_slots; // GravStateSlots states of store and recall, empty until stored
+    t_glist *canvas;                         // Patch of the object, relative state files are found from there
+    std::thread render_worker;               // Offline render thread, joined by the progress clock
+    std::atomic<bool> render_active;         // True while the render thread steps, cleared to stop it
+    std::atomic<uint64_t> render_done;       // Steps the render has done
+    bool render_failed;                      // The render file could not be written, set by the render thread
+    uint64_t render_steps;                   // Steps the render was asked for
+    TrajectoryWriter *render_writer;         // Output file of the render
+    t_clock *render_clock;                   // Reports the render progress
+    std::chrono::steady_clock::time_point render_start; // Start of the render
 };
 
 #endif // GRAF_H
@@ -0,0 +1,274 @@
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+// grav_tilde.cpp - [grav~], the gravity simulation stepped inside the DSP perform routine
+// Every body gets signal outlets for x and y (optionally speed), interpolated between simulation steps.
+// No thread and no message traffic: the simulation runs in the audio callback.
+
+#include "m_pd.h"
+#include "Gravity.h"
+#include "Precision.h"
+
+t_class *grav_class = nullptr; // Gravity reports its errors against this class
+static t_class *grav_tilde_class;
+
+// Internal data structure for the Pure Data object
+struct t_grav_tilde
+{
+    t_object x_obj;
+
+    Gravity<Real> *system;      // Simulation, owned
+    int outputs;          // Bodies with signal outlets
+    bool with_speed;      // Third outlet per body with the speed
+    int signals;          // Values per output frame: outputs * (2 or 3)
+    float steps_per_sec;  // Simulation steps per second
+    float expand_scale;   // Scale for value ranges
+    bool running;         // Simulation advances while true
+    double phase;         // Position between the previous [0] and current [1] step
+    double step_inc;      // Steps per sample, set in dsp
+    float *prev;          // Values of the previous step, signals entries
+    float *cur;           // Values of the current step, signals entries
+    t_sample **out;       // Signal outlet vectors, signals entries
+};
+
+// Copies the simulation state into one output frame
+static void grav_tilde_capture(t_grav_tilde *x, float *dst)
+{
+    const int stride = x->with_speed ? 3 : 2;
+    const int active = x->system->getBodyCount();
+
+    for (int i = 0; i < x->outputs; ++i)
+    {
+        float *v = dst + i * stride;
+
+        // Bodies beyond the active count are silent
+        if (i >= active)
+        {
+            for (int k = 0; k < stride; ++k)
+                v[k] = 0.0f;
+            continue;
+        }
+
+        Body<Real> b = x->system->getBody(i);
+        v[0] = static_cast<float>(b.x) * x->expand_scale;
+        v[1] = static_cast<float>(b.y) * x->expand_scale;
+        if (x->with_speed)
+            v[2] = static_cast<float>(std::sqrt(b.vx * b.vx + b.vy * b.vy)) * x->expand_scale;
+    }
+}
+
+// Both frames show the current state, the next step starts from there
+static void grav_tilde_sync(t_grav_tilde *x)
+{
+    grav_tilde_capture(x, x->cur);
+    for (int k = 0; k < x->signals; ++k)
+        x->prev[k] = x->cur[k];
+    x->phase = 0.0;
+}
+
+// Steps the simulation whenever the phase crosses a step and interpolates linearly in between
+static t_int *grav_tilde_perform(t_int *w)
+{
+    t_grav_tilde *x = reinterpret_cast<t_grav_tilde *>(w[1]);
+    const int n = static_cast<int>(w[2]);
+    const int signals = x->signals;
+    const double inc = x->running ? x->step_inc : 0.0;
+
+    for (int s = 0; s < n; ++s)
+    {
+        x->phase += inc;
+
+        while (x->phase >= 1.0)
+        {
+            float *swap = x->prev;
+            x->prev = x->cur;
+            x->cur = swap;
+
+            x->system->simulate();
+            grav_tilde_capture(x, x->cur);
+            x->phase -= 1.0;
+        }
+
+        const float t = static_cast<float>(x->phase);
+        for (int k = 0; k < signals; ++k)
+            x->out[k][s] = x->prev[k] + (x->cur[k] - x->prev[k]) * t;
+    }
+
+    return w + 3;
+}
+
+// Adds the perform routine to the DSP chain
+static void grav_tilde_dsp(t_grav_tilde *x, t_signal **sp)
+{
+    for (int k = 0; k < x->signals; ++k)
+        x->out[k] = sp[k]->s_vec;
+
+    x->step_inc = x->steps_per_sec / sp[0]->s_sr;
+    dsp_add(grav_tilde_perform, 2, x, static_cast<t_int>(sp[0]->s_n));
+}
+
+// Simulation steps per second, like speed on [grav]: 0 -> 100, 1 -> 5000
+static void grav_tilde_speed(t_grav_tilde *x, t_floatarg val)
+{
+    if (val < 0.0f || val > 1.0f)
+    {
+        pd_error(x, "[grav~] speed must be in range [0.0, 1.0], got %.3f", val);
+        return;
+    }
+
+    int steps = (val > 0) ? static_cast<int>(val * 50) : 1;
+    float sr = sys_getsr();
+    x->steps_per_sec = steps * 100.0f;
+    x->step_inc = sr > 0 ? x->steps_per_sec / sr : 0.0;
+}
+
+// Scaling of value ranges
+static void grav_tilde_scale(t_grav_tilde *x, t_floatarg val)
+{
+    if (val < 1.0f || val > 100.0f)
+    {
+        pd_error(x, "[grav~] scale must be in range [1.0, 100.0], got %.3f", val);
+        return;
+    }
+
+    x->expand_scale = val;
+    grav_tilde_sync(x);
+}
+
+// Set individual body parameters from message: [body index x y vx vy mass(
+static void grav_tilde_body(t_grav_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (argc != 6 || argv[0].a_type != A_FLOAT)
+        return;
+
+    int index = static_cast<int>(atom_getfloat(argv));
+
+    if (index < 0 || index >= x->system->getMaxBodies())
+    {
+        pd_error(x, "[grav~] body index must be between 0 and %d, got %d", x->system->getMaxBodies() - 1, index);
+        return;
+    }
+
+    x->system->setBody(index, atom_getfloat(argv + 1), atom_getfloat(argv + 2), atom_getfloat(argv + 3),
+                       atom_getfloat(argv + 4), atom_getfloat(argv + 5));
+    grav_tilde_sync(x);
+}
+
+// Sets position and mass of the black hole: [hole x y mass(
+static void grav_tilde_hole(t_grav_tilde *x, t_symbol *, int argc, t_atom *argv)
+{
+    if (argc != 3 || argv[0].a_type != A_FLOAT)
+        return;
+
+    x->system->setBlackHole(atom_getfloat(argv), atom_getfloat(argv + 1), atom_getfloat(argv + 2));
+}
+
+// State changes jump, the interpolation restarts from the new state
+static void grav_tilde_preset(t_grav_tilde *x, t_floatarg val)
+{
+    x->system->loadPreset(static_cast<int>(val));
+    grav_tilde_sync(x);
+}
+
+static void grav_tilde_reset(t_grav_tilde *x)
+{
+    x->system->reset();
+    grav_tilde_sync(x);
+}
+
+static void grav_tilde_count(t_grav_tilde *x, t_floatarg val)
+{
+    x->system->setBodyCount(static_cast<int>(val));
+    grav_tilde_sync(x);
+}
+
+static void grav_tilde_start(t_grav_tilde *x) { x->running = true; }
+static void grav_tilde_stop(t_grav_tilde *x) { x->running = false; }
+static void grav_tilde_nudge(t_grav_tilde *x) { x->system->nudge(); }
+
+// Parameter setters delegate to simulation
+static void grav_tilde_dt(t_grav_tilde *x, t_floatarg val) { x->system->setDt(val); }
+static void grav_tilde_G(t_grav_tilde *x, t_floatarg val) { x->system->setG(val); }
+static void grav_tilde_posdamp(t_grav_tilde *x, t_floatarg val) { x->system->setPosDamping(val); }
+static void grav_tilde_veldamp(t_grav_tilde *x, t_floatarg val) { x->system->setVelDamping(val); }
+static void grav_tilde_softening(t_grav_tilde *x, t_floatarg val) { x->system->setSoftening(val); }
+static void grav_tilde_vmin(t_grav_tilde *x, t_floatarg val) { x->system->setVmin(val); }
+static void grav_tilde_vmax(t_grav_tilde *x, t_floatarg val) { x->system->setVmax(val); }
+static void grav_tilde_seed(t_grav_tilde *x, t_floatarg val) { x->system->setSeed(static_cast<int>(val)); }
+static void grav_tilde_simd(t_grav_tilde *x, t_symbol *s) { x->system->setSimd(s->s_name); }
+static void grav_tilde_engine(t_grav_tilde *x, t_symbol *s) { x->system->setEngine(s->s_name); }
+static void grav_tilde_theta(t_grav_tilde *x, t_floatarg val) { x->system->setTheta(val); }
+
+// Creates new instance of the PD object
+// Creation arguments: bodies with outlets (default 3) and 1 for an extra speed outlet per body [grav~ 4 1]
+static void *grav_tilde_new(t_floatarg bodies, t_floatarg speed)
+{
+    t_grav_tilde *x = reinterpret_cast<t_grav_tilde *>(pd_new(grav_tilde_class));
+
+    int outputs = (bodies > 0) ? static_cast<int>(bodies) : 3;
+
+    if (outputs > Gravity<Real>::MaxBodyLimit)
+    {
+        pd_error(x, "[grav~] bodies must be between 1 and %d, got %d => clamped", Gravity<Real>::MaxBodyLimit, outputs);
+        outputs = Gravity<Real>::MaxBodyLimit;
+    }
+
+    x->outputs = outputs;
+    x->with_speed = speed != 0;
+    x->signals = outputs * (x->with_speed ? 3 : 2);
+    x->expand_scale = 1;
+    x->running = false;
+    x->steps_per_sec = 100.0f;
+    x->step_inc = 0.0;
+
+    x->system = new Gravity<Real>(outputs);
+    x->prev = new float[x->signals];
+    x->cur = new float[x->signals];
+    x->out = new t_sample *[x->signals];
+
+    for (int k = 0; k < x->signals; ++k)
+        outlet_new(&x->x_obj, &s_signal);
+
+    grav_tilde_sync(x);
+    return x;
+}
+
+// Destructor: frees simulation object and buffers
+static void grav_tilde_free(t_grav_tilde *x)
+{
+    delete x->system;
+    delete[] x->prev;
+    delete[] x->cur;
+    delete[] x->out;
+}
+
+// Setup function: called when external is loaded by PD
+extern "C" void grav_tilde_setup(void)
+{
+    grav_tilde_class = class_new(gensym("grav~"),
+                                 reinterpret_cast<t_newmethod>(grav_tilde_new),
+                                 reinterpret_cast<t_method>(grav_tilde_free),
+                                 sizeof(t_grav_tilde),
+                                 CLASS_DEFAULT, A_DEFFLOAT, A_DEFFLOAT, 0);
+
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_dsp), gensym("dsp"), A_CANT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_body), gensym("body"), A_GIMME, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_hole), gensym("hole"), A_GIMME, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_dt), gensym("dt"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_G), gensym("G"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_posdamp), gensym("posdamp"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_veldamp), gensym("veldamp"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_softening), gensym("softening"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_vmin), gensym("vmin"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_vmax), gensym("vmax"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_preset), gensym("preset"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_count), gensym("count"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_reset), gensym("reset"), A_NULL);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_start), gensym("start"), A_NULL);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_stop), gensym("stop"), A_NULL);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_speed), gensym("speed"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_scale), gensym("scale"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_nudge), gensym("nudge"), A_NULL);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_seed), gensym("seed"), A_FLOAT, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_simd), gensym("simd"), A_SYMBOL, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_engine), gensym("engine"), A_SYMBOL, 0);
+    class_addmethod(grav_tilde_class, reinterpret_cast<t_method>(grav_tilde_theta), gensym("theta"), A_FLOAT, 0);
+}
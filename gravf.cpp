@@ -2,12 +2,16 @@
 // gravf.cpp
 // Pure Data external for analyzing positional data from [grav]
 // Mode-based output: distance, angle, etc.
+// [gravf matrix <mode> [array]] analyses all body pairs of a [grav] batch frame in one message
+// [gravf <mode> <name> <body1> <body2>] reads the bodies from [grav <name>] on bang, without lists
 
 #include "m_pd.h"
 #include <vector>
 #include <string>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
+#include "SharedSnapshot.h"
 
 static t_class *gravf_class;
 struct t_gravf;
@@ -15,6 +19,28 @@ struct t_gravf;
 // Function to execute
 typedef void (*Calculations)(t_gravf *x, int argc, t_atom *argv);
 
+// Function on two bodies of a shared frame
+typedef void (*SharedCalculations)(t_gravf *x, const SharedBody &a, const SharedBody &b);
+
+// Computes one value for every pair i < j of n bodies into out, ordered (0,1), (0,2), ... (n-2,n-1)
+typedef void (*PairKernel)(const float *x, const float *y, const float *vx, const float *vy, int n, float *out);
+
+// State of the matrix mode, the buffers grow with the largest frame seen
+struct GravfMatrix
+{
+    static const int MaxBodies = 1024; // Bodies analysed per frame, 523776 pairs
+
+    PairKernel kernel;
+    bool velocities;        // Kernel reads vx vy
+    t_symbol *array;        // Target garray, &s_ for the outlet
+    std::vector<float> x;   // Body values of the frame as separate arrays, so the kernels vectorize
+    std::vector<float> y;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> values; // One value per pair
+    std::vector<t_atom> atoms; // Output list
+};
+
 struct t_gravf
 {
     t_object x_obj;
@@ -25,6 +51,13 @@ struct t_gravf
     float data1; // data componenents from right inlet
 
     bool tmpb1;  // temporary state value
+
+    GravfMatrix *matrix; // Matrix mode only
+
+    SharedCalculations shared; // Mode on bodies of a shared frame
+    t_symbol *source;          // Name of the [grav] read on bang, &s_ for list input only
+    int body1;                 // Bodies read from the shared frame
+    int body2;
 };
 
 // Helper: calculate distance
@@ -60,8 +93,12 @@ void calcDistance(t_gravf *x, int argc, t_atom *argv)
     const float x2 = atom_getfloat(argv + 2);
     const float y2 = atom_getfloat(argv + 3);
 
-    float d = distance(x1, y1, x2, y2);
-    outlet_float(x->x_out, d);
+    outlet_float(x->x_out, distance(x1, y1, x2, y2));
+}
+
+void sharedDistance(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outlet_float(x->x_out, distance(a.x, a.y, b.x, b.y));
 }
 
 // Calulates the angle between two bodies
@@ -78,8 +115,12 @@ void calcAngle(t_gravf *x, int argc, t_atom *argv)
     const float x2 = atom_getfloat(argv + 2);
     const float y2 = atom_getfloat(argv + 3);
 
-    float a = angle(x1, y1, x2, y2);
-    outlet_float(x->x_out, a);
+    outlet_float(x->x_out, angle(x1, y1, x2, y2));
+}
+
+void sharedAngle(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outlet_float(x->x_out, angle(a.x, a.y, b.x, b.y));
 }
 
 // Calulates the relative velocity between two bodies
@@ -96,10 +137,23 @@ void calcRelativeV(t_gravf *x, int argc, t_atom *argv)
     const float x2 = atom_getfloat(argv + 2);
     const float y2 = atom_getfloat(argv + 3);
 
-    float dvx = x2 - x1;
-    float dvy = y2 - y1;
-    float speed = std::sqrt(dvx * dvx + dvy * dvy);
-    outlet_float(x->x_out, speed);
+    outlet_float(x->x_out, distance(x1, y1, x2, y2));
+}
+
+void sharedRelativeV(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outlet_float(x->x_out, distance(a.vx, a.vy, b.vx, b.vy));
+}
+
+// Approach rate: change of the distance per time, negative while the bodies get closer
+static float approach(float x1, float y1, float x2, float y2, float vx1, float vy1, float vx2, float vy2)
+{
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float dvx = vx2 - vx1;
+    float dvy = vy2 - vy1;
+    float dist = sqrt(dx * dx + dy * dy);
+    return (dist != 0) ? (dvx * dx + dvy * dy) / dist : 0.0f;
 }
 
 // Calulates the approach rate between two bodies
@@ -120,13 +174,21 @@ void calcApproach(t_gravf *x, int argc, t_atom *argv)
     const float vx2 = atom_getfloat(argv + 6);
     const float vy2 = atom_getfloat(argv + 7);
 
-    float dx = x2 - x1;
-    float dy = y2 - y1;
-    float dvx = vx2 - vx1;
-    float dvy = vy2 - vy1;
-    float dist = sqrt(dx * dx + dy * dy);
-    float rate = (dist != 0) ? (dvx * dx + dvy * dy) / dist : 0.0f;
-    outlet_float(x->x_out, rate);
+    outlet_float(x->x_out, approach(x1, y1, x2, y2, vx1, vy1, vx2, vy2));
+}
+
+void sharedApproach(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outlet_float(x->x_out, approach(a.x, a.y, b.x, b.y, a.vx, a.vy, b.vx, b.vy));
+}
+
+// Sends the point between two positions
+static void outCenter(t_gravf *x, float x1, float y1, float x2, float y2)
+{
+    t_atom out[2];
+    SETFLOAT(&out[0], (x1 + x2) / 2.0f);
+    SETFLOAT(&out[1], (y1 + y2) / 2.0f);
+    outlet_list(x->x_out, &s_list, 2, out);
 }
 
 // Calculates the center between two bodies
@@ -143,10 +205,29 @@ void calcCenter(t_gravf *x, int argc, t_atom *argv)
     const float x2 = atom_getfloat(argv + 2);
     const float y2 = atom_getfloat(argv + 3);
 
-    t_atom out[2];
-    SETFLOAT(&out[0], (x1 + x2) / 2.0f);
-    SETFLOAT(&out[1], (y1 + y2) / 2.0f);
-    outlet_list(x->x_out, &s_list, 2, out);
+    outCenter(x, x1, y1, x2, y2);
+}
+
+void sharedCenter(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outCenter(x, a.x, a.y, b.x, b.y);
+}
+
+// Sends 1 when the distance falls to data1 or below, 0 when it exceeds data1 again
+static void outInZone(t_gravf *x, float d)
+{
+    // data1 = defined distance
+    // tmp1b = current in/out status
+    if (d <= x->data1 && !x->tmpb1)
+    {
+        x->tmpb1 = true;
+        outlet_float(x->x_out, 1.0f);
+    }
+    else if (d > x->data1 && x->tmpb1)
+    {
+        x->tmpb1 = false;
+        outlet_float(x->x_out, 0.0f);
+    }
 }
 
 // Sends a bang when if a distance value has been exceeded
@@ -163,20 +244,285 @@ void calcInZone(t_gravf *x, int argc, t_atom *argv)
     const float x2 = atom_getfloat(argv + 2);
     const float y2 = atom_getfloat(argv + 3);
 
-    float d = distance(x1, y1, x2, y2);
+    outInZone(x, distance(x1, y1, x2, y2));
+}
 
-    // data1 = defined distance
-    // tmp1b = current in/out status
-    if (d <= x->data1 && !x->tmpb1)
+void sharedInZone(t_gravf *x, const SharedBody &a, const SharedBody &b)
+{
+    outInZone(x, distance(a.x, a.y, b.x, b.y));
+}
+
+// Pair kernels of the matrix mode. Each inner loop runs over contiguous arrays without branches and is
+// marked for SIMD (-fopenmp-simd), -fno-math-errno lets sqrt vectorize.
+static void pairsDistance(const float *x, const float *y, const float *, const float *, int n, float *out)
+{
+    for (int i = 0; i < n - 1; ++i)
     {
-        x->tmpb1 = true;
-        outlet_float(x->x_out, 1.0f);
+        const float xi = x[i], yi = y[i];
+        const int m = n - i - 1;
+        const float *__restrict xj = x + i + 1;
+        const float *__restrict yj = y + i + 1;
+        float *__restrict o = out;
+
+#pragma omp simd
+        for (int j = 0; j < m; ++j)
+        {
+            float dx = xj[j] - xi;
+            float dy = yj[j] - yi;
+            o[j] = std::sqrt(dx * dx + dy * dy);
+        }
+
+        out += m;
     }
-    else if (d > x->data1 && x->tmpb1)
+}
+
+static void pairsRelativeV(const float *, const float *, const float *vx, const float *vy, int n, float *out)
+{
+    pairsDistance(vx, vy, nullptr, nullptr, n, out);
+}
+
+static void pairsApproach(const float *x, const float *y, const float *vx, const float *vy, int n, float *out)
+{
+    for (int i = 0; i < n - 1; ++i)
     {
-        x->tmpb1 = false;
-        outlet_float(x->x_out, 0.0f);
+        const float xi = x[i], yi = y[i], vxi = vx[i], vyi = vy[i];
+        const int m = n - i - 1;
+        const float *__restrict xj = x + i + 1;
+        const float *__restrict yj = y + i + 1;
+        const float *__restrict vxj = vx + i + 1;
+        const float *__restrict vyj = vy + i + 1;
+        float *__restrict o = out;
+
+#pragma omp simd
+        for (int j = 0; j < m; ++j)
+        {
+            float dx = xj[j] - xi;
+            float dy = yj[j] - yi;
+            float dist = std::sqrt(dx * dx + dy * dy);
+            float rate = ((vxj[j] - vxi) * dx + (vyj[j] - vyi) * dy) / dist;
+            o[j] = dist != 0.0f ? rate : 0.0f;
+        }
+
+        out += m;
+    }
+}
+
+// atan2 has no vector form here, this one stays scalar
+static void pairsAngle(const float *x, const float *y, const float *, const float *, int n, float *out)
+{
+    for (int i = 0; i < n - 1; ++i)
+        for (int j = i + 1; j < n; ++j)
+            *out++ = angle(x[i], y[i], x[j], y[j]);
+}
+
+// Grows the buffers to count bodies, once for the largest frame
+static void matrixReserve(GravfMatrix *m, int count)
+{
+    size_t pairs = static_cast<size_t>(count) * (count > 0 ? count - 1 : 0) / 2;
+
+    if (m->x.size() < static_cast<size_t>(count))
+    {
+        m->x.resize(count);
+        m->y.resize(count);
+        m->vx.resize(count);
+        m->vy.resize(count);
+    }
+    if (m->values.size() < pairs)
+        m->values.resize(pairs);
+}
+
+// Runs the kernel on the first count bodies of the buffers and sends the pairs
+static void matrixOutput(t_gravf *x, int count)
+{
+    GravfMatrix *m = x->matrix;
+    size_t pairs = static_cast<size_t>(count) * (count > 0 ? count - 1 : 0) / 2;
+
+    m->kernel(m->x.data(), m->y.data(), m->vx.data(), m->vy.data(), count, m->values.data());
+
+    if (m->array != &s_)
+    {
+        t_garray *array = reinterpret_cast<t_garray *>(pd_findbyclass(m->array, garray_class));
+        int size = 0;
+        t_word *vec = nullptr;
+
+        if (array == nullptr || !garray_getfloatwords(array, &size, &vec))
+        {
+            pd_error(x, "[gravf] matrix array '%s' not found", m->array->s_name);
+            return;
+        }
+
+        // Resizing allocates, so it only happens when the body count changes
+        if (size != static_cast<int>(pairs))
+        {
+            garray_resize_long(array, pairs > 0 ? pairs : 1);
+            if (!garray_getfloatwords(array, &size, &vec) || size < static_cast<int>(pairs))
+                return;
+        }
+
+        for (size_t k = 0; k < pairs; ++k)
+            vec[k].w_float = m->values[k];
+
+        outlet_bang(x->x_out);
+        return;
+    }
+
+    if (m->atoms.size() < pairs)
+        m->atoms.resize(pairs);
+
+    for (size_t k = 0; k < pairs; ++k)
+        SETFLOAT(&m->atoms[k], m->values[k]);
+
+    outlet_list(x->x_out, &s_list, static_cast<int>(pairs), m->atoms.data());
+}
+
+// Analyses a whole [grav] batch frame: count, hole x, hole y, then the fields of every body.
+// The frame must start with pos (fields pos, or pos vel for relativev and approach).
+void calcMatrix(t_gravf *x, int argc, t_atom *argv)
+{
+    GravfMatrix *m = x->matrix;
+    int count = (argc >= 3) ? static_cast<int>(atom_getfloat(argv)) : -1;
+
+    if (count < 0 || argc < 3 + count * 2)
+    {
+        pd_error(x, "[gravf] invalid frame for matrix: expecting a [grav] batch list [count, hole.x, hole.y, body values...(");
+        return;
+    }
+
+    int stride = count > 0 ? (argc - 3) / count : 0;
+    int need = m->velocities ? 4 : 2;
+
+    if (count > 0 && stride < need)
+    {
+        pd_error(x, "[gravf] matrix needs %s per body, got %d values", m->velocities ? "x y vx vy" : "x y", stride);
+        return;
+    }
+
+    if (count > GravfMatrix::MaxBodies)
+    {
+        pd_error(x, "[gravf] matrix analyses at most %d bodies, got %d => clamped", GravfMatrix::MaxBodies, count);
+        count = GravfMatrix::MaxBodies;
+    }
+
+    matrixReserve(m, count);
+
+    const t_atom *body = argv + 3;
+    for (int i = 0; i < count; ++i, body += stride)
+    {
+        m->x[i] = atom_getfloat(body);
+        m->y[i] = atom_getfloat(body + 1);
+
+        if (m->velocities)
+        {
+            m->vx[i] = atom_getfloat(body + 2);
+            m->vy[i] = atom_getfloat(body + 3);
+        }
+    }
+
+    matrixOutput(x, count);
+}
+
+// Matrix of the bodies of a shared frame
+static void matrixShared(t_gravf *x, const SharedSnapshot &snapshot)
+{
+    GravfMatrix *m = x->matrix;
+    int count = 0;
+
+    // Buffers for the whole capacity, so the copy under the lock never allocates
+    matrixReserve(m, std::min(snapshot.getCapacity(), static_cast<int>(GravfMatrix::MaxBodies)));
+
+    bool ok = snapshot.read([m, &count](const SharedBody *bodies, int n, const SharedBody &, uint64_t)
+                            {
+                                count = std::min(n, static_cast<int>(GravfMatrix::MaxBodies));
+
+                                for (int i = 0; i < count; ++i)
+                                {
+                                    m->x[i] = bodies[i].x;
+                                    m->y[i] = bodies[i].y;
+                                    m->vx[i] = bodies[i].vx;
+                                    m->vy[i] = bodies[i].vy;
+                                } });
+
+    if (!ok)
+        return;
+
+    matrixOutput(x, count);
+}
+
+// Reads the latest frame of the source [grav] and analyses it
+void gravf_bang(t_gravf *x)
+{
+    if (x->source == &s_ || (x->matrix == nullptr && x->shared == nullptr))
+    {
+        pd_error(x, "[gravf] bang needs a source: [gravf <mode> <name> <body1> <body2>] or [source <name>(");
+        return;
+    }
+
+    SharedSnapshot *snapshot = findSharedSnapshot(x->source);
+
+    if (snapshot == nullptr)
+    {
+        pd_error(x, "[gravf] no [grav %s] found", x->source->s_name);
+        return;
     }
+
+    if (x->matrix != nullptr)
+    {
+        matrixShared(x, *snapshot);
+        return;
+    }
+
+    SharedBody a{}, b{};
+    int count = 0;
+    int i = x->body1, j = x->body2;
+
+    bool ok = snapshot->read([&a, &b, &count, i, j](const SharedBody *bodies, int n, const SharedBody &, uint64_t)
+                             {
+                                 count = n;
+                                 if (i < n && j < n)
+                                 {
+                                     a = bodies[i];
+                                     b = bodies[j];
+                                 } });
+
+    if (!ok)
+        return;
+
+    if (i >= count || j >= count)
+    {
+        pd_error(x, "[gravf] bodies %d and %d: [grav %s] has %d bodies", i, j, x->source->s_name, count);
+        return;
+    }
+
+    x->shared(x, a, b);
+}
+
+// Selects the [grav <name>] read on bang, optionally with new bodies: [source <name> [body1 body2](
+void gravf_source(t_gravf *x, t_symbol *, int argc, t_atom *argv)
+{
+    t_symbol *name = atom_getsymbolarg(0, argc, argv);
+
+    if (name == &s_)
+    {
+        pd_error(x, "[gravf] source expects the name of a [grav]");
+        return;
+    }
+
+    if (argc >= 3)
+    {
+        int i = static_cast<int>(atom_getfloatarg(1, argc, argv));
+        int j = static_cast<int>(atom_getfloatarg(2, argc, argv));
+
+        if (i < 0 || j < 0)
+        {
+            pd_error(x, "[gravf] body indices must not be negative, got %d %d", i, j);
+            return;
+        }
+
+        x->body1 = i;
+        x->body2 = j;
+    }
+
+    x->source = name;
 }
 
 // Core list processing
@@ -191,52 +537,98 @@ void *gravf_new([[maybe_unused]] t_symbol *s, int argc, t_atom *argv)
     t_gravf *x = (t_gravf *)pd_new(gravf_class);
 
     t_symbol *mode;
+    x->source = &s_;
 
     if (argc >= 1 && argv[0].a_type == A_SYMBOL)
         mode = argv[0].a_w.w_symbol;
     else
     {
-        pd_error(x, "[gravf] invalid or missing method name: expecting distance, angle, relativev, approach, center, inzone");
+        pd_error(x, "[gravf] invalid or missing method name: expecting distance, angle, relativev, approach, center, inzone, matrix");
         return (void *)x;
     }
 
-    if (mode == gensym("distance"))
+    if (mode == gensym("matrix"))
+    {
+        t_symbol *quantity = (argc >= 2) ? atom_getsymbol(argv + 1) : &s_;
+        x->matrix = new GravfMatrix();
+        x->matrix->array = (argc >= 3) ? atom_getsymbol(argv + 2) : &s_;
+        x->matrix->velocities = false;
+        x->func = calcMatrix;
+
+        if (quantity == gensym("distance"))
+            x->matrix->kernel = pairsDistance;
+        else if (quantity == gensym("angle"))
+            x->matrix->kernel = pairsAngle;
+        else if (quantity == gensym("relativev"))
+        {
+            x->matrix->kernel = pairsRelativeV;
+            x->matrix->velocities = true;
+        }
+        else if (quantity == gensym("approach"))
+        {
+            x->matrix->kernel = pairsApproach;
+            x->matrix->velocities = true;
+        }
+        else
+        {
+            x->func = calcdefault;
+            pd_error(x, "[gravf] unknown matrix function '%s': expecting distance, angle, relativev, approach", quantity->s_name);
+        }
+    }
+    else if (mode == gensym("distance"))
     {
         x->func = calcDistance;
+        x->shared = sharedDistance;
     }
     else if (mode == gensym("angle"))
     {
         x->func = calcAngle;
+        x->shared = sharedAngle;
     }
     else if (mode == gensym("relativev"))
     {
         x->func = calcRelativeV;
+        x->shared = sharedRelativeV;
     }
     else if (mode == gensym("approach"))
     {
         x->func = calcApproach;
+        x->shared = sharedApproach;
     }
     else if (mode == gensym("center"))
     {
         x->func = calcCenter;
+        x->shared = sharedCenter;
     }
     else if (mode == gensym("inzone"))
     {
         x->func = calcInZone;
+        x->shared = sharedInZone;
         x->tmpb1 = false;
     }
     else
     {
         x->func = calcdefault;
-        pd_error(x, "[gravf] unknown analysis function '%s': expecting distance, angle, relativev, approach, center, inzone", mode->s_name);
+        pd_error(x, "[gravf] unknown analysis function '%s': expecting distance, angle, relativev, approach, center, inzone, matrix", mode->s_name);
     }
 
+    // Shared source of the pair modes: [gravf distance sun 3 7]
+    if (x->shared != nullptr && argc >= 2)
+        gravf_source(x, gensym("source"), argc - 1, argv + 1);
+
     x->x_out = outlet_new(&x->x_obj, &s_list);
     x->x_in_data = floatinlet_new(&x->x_obj, &x->data1); //receives values from inlet 2
 
     return (void *)x;
 }
 
+// Frees the buffers of the matrix mode
+void gravf_free(t_gravf *x)
+{
+    delete x->matrix;
+    x->matrix = nullptr;
+}
+
 extern "C"
 {
     void gravf_setup(void)
@@ -244,11 +636,13 @@ extern "C"
         gravf_class = class_new(
             gensym("gravf"),
             (t_newmethod)gravf_new,
-            0,
+            (t_method)gravf_free,
             sizeof(t_gravf),
             CLASS_DEFAULT,
             A_GIMME, 0);
 
         class_addlist(gravf_class, (t_method)gravf_list);
+        class_addbang(gravf_class, (t_method)gravf_bang);
+        class_addmethod(gravf_class, (t_method)gravf_source, gensym("source"), A_GIMME, 0);
     }
 }
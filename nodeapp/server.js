@@ -1,12 +1,16 @@
 const express = require("express");
 const dgram = require("dgram");
+const http = require("http");
 const path = require("path");
+const { WebSocketServer, WebSocket } = require("ws");
 
 const app = express();
 const PORT = 8080;
 const enablePrint = process.argv.includes("-p");
 
 const udp = dgram.createSocket("udp4");
+const server = http.createServer(app);
+const wss = new WebSocketServer({ server });
 
 // Init fallback values
 let lastKnownCoords = {};
@@ -14,8 +18,163 @@ for (let i = 0; i < 11; i++) {
   lastKnownCoords[`id${i}`] = [0, 0];
 }
 
-// Handle incoming UDP messages
-udp.on("message", (msg) => {
+// Trail history: the last HISTORY_LENGTH positions of every body, preallocated per body count.
+// Like TrailHistory::MaxPoints on [grav] the positions of all bodies are bounded (32 MB), so
+// large systems keep shorter trails.
+const HISTORY_LENGTH = 2000;
+const HISTORY_MAX_POINTS = 1 << 22;
+const MAX_BODIES = 1 << 16;
+let history = { bodies: 0, length: 0, written: 0, data: new Float32Array(0) };
+
+function recordHistory(coords, bodies) {
+  // The hole is kept as the last id like in the frames
+  const ids = bodies + 1;
+
+  if (history.bodies !== ids) {
+    const length = Math.min(HISTORY_LENGTH, Math.floor(HISTORY_MAX_POINTS / ids));
+    history = { bodies: ids, length, written: 0, data: new Float32Array(length * ids * 2) };
+  }
+
+  const row = (history.written % history.length) * ids * 2;
+  for (let i = 0; i < ids; i++) {
+    const pos = coords[`id${i}`] || [0, 0];
+    history.data[row + i * 2] = pos[0];
+    history.data[row + i * 2 + 1] = pos[1];
+  }
+  history.written++;
+}
+
+// Trail of one id, oldest first, at most points positions spread evenly (0 for all)
+function trail(id, points) {
+  const available = Math.min(history.written, history.length);
+  const begin = history.written - available;
+  const n = (points > 0 && points < available) ? points : available;
+  const result = [];
+
+  for (let j = 0; j < n; j++) {
+    const k = begin + (n > 1 ? Math.floor(j * (available - 1) / (n - 1)) : available - 1);
+    const offset = (k % history.length) * history.bodies * 2 + id * 2;
+    result.push([history.data[offset], history.data[offset + 1]]);
+  }
+
+  return result;
+}
+
+// A complete frame from either UDP format
+function publish(coords, bodies) {
+  lastKnownCoords = coords;
+  recordHistory(coords, bodies);
+  broadcast(coords, bodies);
+}
+
+// Frame for the browsers as Float32Array: [bodies, radius (NaN if none), hole x, hole y, x0, y0, x1, y1, ...]
+function encodeFrame(coords, bodies) {
+  const frame = new Float32Array(4 + bodies * 2);
+  const hole = coords[`id${bodies}`];
+  frame[0] = bodies;
+  frame[1] = typeof coords.radius === "number" ? coords.radius : NaN;
+  frame[2] = hole[0];
+  frame[3] = hole[1];
+
+  for (let i = 0; i < bodies; i++) {
+    const pos = coords[`id${i}`] || [0, 0];
+    frame[4 + i * 2] = pos[0];
+    frame[5 + i * 2] = pos[1];
+  }
+
+  return frame;
+}
+
+// Pushes a frame to every browser, encoded once
+function broadcast(coords, bodies) {
+  if (wss.clients.size === 0)
+    return;
+
+  const frame = encodeFrame(coords, bodies);
+
+  // A client that cannot keep up skips frames instead of queueing them
+  for (const client of wss.clients) {
+    if (client.readyState === WebSocket.OPEN && client.bufferedAmount < frame.byteLength * 4)
+      client.send(frame);
+  }
+}
+
+// Binary frames of [stream <host> <port>( on [grav], see FrameStreamer.h for the layout
+const FRAME_MAGIC = "GRAV";
+const FRAME_HEADER = 40;
+const FIELD_POS = 1, FIELD_VEL = 2, FIELD_ACC = 4, FIELD_MASS = 8;
+
+// Frame being assembled from its datagrams
+let pending = null;
+let lastSequence = 0;
+let framesLost = 0;
+
+function handleBinary(msg) {
+  if (msg.readUInt16LE(4) !== 1) {
+    console.warn("Unsupported frame version:", msg.readUInt16LE(4));
+    return;
+  }
+
+  const fields = msg.readUInt16LE(6);
+  const sequence = msg.readUInt32LE(8);
+  const total = msg.readUInt32LE(12);
+  const first = msg.readUInt32LE(16);
+  const count = msg.readUInt32LE(20);
+  const stride = ((fields & FIELD_POS) ? 2 : 0) + ((fields & FIELD_VEL) ? 2 : 0) +
+                 ((fields & FIELD_ACC) ? 2 : 0) + ((fields & FIELD_MASS) ? 1 : 0);
+
+  if (total > MAX_BODIES) {
+    console.warn("Frame", sequence, "has", total, "bodies, frames of more than", MAX_BODIES, "are dropped");
+    return;
+  }
+
+  if (msg.length < FRAME_HEADER + count * stride * 4 || first + count > total) {
+    console.warn("Truncated frame", sequence, "length:", msg.length);
+    return;
+  }
+
+  // A new sequence number starts a frame, parts of an unfinished one are lost
+  if (!pending || pending.sequence !== sequence) {
+    pending = {
+      sequence,
+      total,
+      received: 0,
+      coords: {},
+      hole: [msg.readFloatLE(28), msg.readFloatLE(32)],
+    };
+  }
+
+  if (fields & FIELD_POS) {
+    for (let i = 0; i < count; i++) {
+      const offset = FRAME_HEADER + i * stride * 4;
+      pending.coords[`id${first + i}`] = [msg.readFloatLE(offset), msg.readFloatLE(offset + 4)];
+    }
+  }
+
+  pending.received += count;
+  if (pending.received < total)
+    return;
+
+  if (lastSequence !== 0 && sequence > lastSequence + 1)
+    framesLost += sequence - lastSequence - 1;
+  lastSequence = sequence;
+
+  // Same layout as the text frames: the black hole follows the bodies, radius stays from the patch
+  const newCoords = pending.coords;
+  newCoords[`id${total}`] = pending.hole;
+  if ("radius" in lastKnownCoords)
+    newCoords["radius"] = lastKnownCoords["radius"];
+
+  pending = null;
+  publish(newCoords, total);
+
+  if (enablePrint) {
+    console.log(`frame ${sequence}: ${total} bodies, lost ${framesLost}`);
+  }
+}
+
+// FUDI text of the help patch: 10 bodies, the black hole and a radius
+function handleText(msg) {
   const text = msg.toString().trim().replace(/[;,]/g, "");
   const values = text.split(/\s+/).map(Number);
 
@@ -33,7 +192,7 @@ udp.on("message", (msg) => {
     const radiusValue = values[22];
     newCoords["radius"] = radiusValue;
 
-    lastKnownCoords = newCoords;
+    publish(newCoords, 10);
 
     if (enablePrint) {
       const line = Object.entries(newCoords)
@@ -46,6 +205,14 @@ udp.on("message", (msg) => {
     console.warn("Invalid UDP data received:", text);
     console.warn("Invalid data:", values, "length:", values.length);
   }
+}
+
+// Handle incoming UDP messages
+udp.on("message", (msg) => {
+  if (msg.length >= FRAME_HEADER && msg.toString("latin1", 0, 4) === FRAME_MAGIC)
+    handleBinary(msg);
+  else
+    handleText(msg);
 });
 
 // Start UDP server
@@ -56,12 +223,39 @@ udp.bind(5000, () => {
 // Serve frontend
 app.use(express.static(path.join(__dirname)));
 
-// REST-API: get latest coords
+// REST-API: get latest coords (the page itself uses the WebSocket push)
 app.get("/data", (req, res) => {
   res.json(lastKnownCoords);
 });
 
-// Start HTTP server
-app.listen(PORT, () => {
+// Trails: /history?points=200 for all ids, /history?body=3&points=200 for one, oldest first
+app.get("/history", (req, res) => {
+  const points = parseInt(req.query.points) || 0;
+
+  if (req.query.body !== undefined) {
+    const body = parseInt(req.query.body);
+    if (isNaN(body) || body < 0 || body >= history.bodies) {
+      res.status(400).json({ error: `body must be in range [0, ${history.bodies - 1}]` });
+      return;
+    }
+    res.json(trail(body, points));
+    return;
+  }
+
+  const trails = {};
+  for (let i = 0; i < history.bodies; i++)
+    trails[`id${i}`] = trail(i, points);
+  res.json(trails);
+});
+
+// Late clients get the current frame at once
+wss.on("connection", (client) => {
+  const bodies = Object.keys(lastKnownCoords).filter(k => k.startsWith("id")).length - 1;
+  if (bodies >= 0)
+    client.send(encodeFrame(lastKnownCoords, bodies));
+});
+
+// Start HTTP and WebSocket server
+server.listen(PORT, () => {
   console.log(`Start frontend: http://localhost:${PORT}`);
 });
@@ -0,0 +1,24 @@
+// pd_stub.cpp – Minimal logging layer so the simulation core links without Pure Data
+// Used by the bench target, messages go to stderr
+
+#include <cstdio>
+#include <cstdarg>
+#include "m_pd.h"
+
+t_class *grav_class = nullptr; // Referenced by the core for pd_error
+
+void post(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+void pd_error(const void *object, const char *fmt, ...)
+{
+    (void)object;
+
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+}
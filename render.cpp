@@ -0,0 +1,109 @@
+// render.cpp – Offline render of a preset to a WAV file, no Pure Data needed
+// make render && build/render <preset> <steps> <file.wav> [every] [rate] [integrator]
+// Runs the preset as fast as the CPU allows and writes x y of every body for every nth step as one
+// 32 bit float sample frame, the same file [render( of [grav] writes for the pos field.
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "Gravity.h"
+#include "TrajectoryWriter.h"
+#include "Precision.h"
+
+static const double ProgressSeconds = 1.0; // Interval of the progress lines on stderr
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::fprintf(stderr, "usage: %s <preset> <steps> <file.wav> [every] [rate] [integrator]\n", argv[0]);
+        return 1;
+    }
+
+    int preset = std::atoi(argv[1]);
+    long long steps = std::atoll(argv[2]);
+    const char *path = argv[3];
+    int every = argc > 4 ? std::atoi(argv[4]) : 1;
+    int rate = argc > 5 ? std::atoi(argv[5]) : 44100;
+
+    if (steps < 1 || every < 1 || rate < 1)
+    {
+        std::fprintf(stderr, "steps, every and rate must be >= 1\n");
+        return 1;
+    }
+
+    Gravity<Real> system;
+    system.loadPreset(preset);
+
+    if (argc > 6 && !system.setIntegrator(argv[6]))
+        return 1;
+
+    const int bodies = system.getBodyCount();
+    TrajectoryWriter writer;
+
+    if (2 * bodies > TrajectoryWriter::MaxChannels)
+    {
+        std::fprintf(stderr, "%d bodies exceed the %d channels of a WAV file\n", bodies, TrajectoryWriter::MaxChannels);
+        return 1;
+    }
+
+    if (!writer.open(path, 2 * bodies, rate))
+    {
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+
+    std::vector<Body<Real>> frame(static_cast<size_t>(system.getMaxBodies()));
+    std::vector<float> values(static_cast<size_t>(2 * bodies));
+
+    auto start = std::chrono::steady_clock::now();
+    auto report = start;
+    long long done = 0;
+    bool ok = true;
+
+    for (done = 1; done <= steps && ok; ++done)
+    {
+        system.simulate();
+
+        if (done % every == 0)
+        {
+            system.copyBodies(frame.data());
+
+            for (int i = 0; i < bodies; ++i)
+            {
+                values[2 * i] = static_cast<float>(frame[i].x);
+                values[2 * i + 1] = static_cast<float>(frame[i].y);
+            }
+
+            ok = writer.write(values.data());
+        }
+
+        // The clock is read once per 4096 steps, not per step
+        if ((done & 4095) == 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - report).count() >= ProgressSeconds)
+            {
+                std::fprintf(stderr, "%lld / %lld steps\n", done, steps);
+                report = now;
+            }
+        }
+    }
+
+    done--;
+    ok = writer.close() && ok;
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::printf("{\"preset\": %d, \"bodies\": %d, \"steps\": %lld, \"frames\": %llu, \"seconds\": %.3f, \"steps_per_second\": %.0f}\n",
+                preset, bodies, done, static_cast<unsigned long long>(writer.getFrames()), seconds.count(),
+                seconds.count() > 0 ? done / seconds.count() : 0.0);
+
+    if (!ok)
+    {
+        std::fprintf(stderr, "cannot write %s: disk full or 4 GB reached\n", path);
+        return 1;
+    }
+
+    return 0;
+}